@@ -27,6 +27,14 @@ Uniform::get_avg_dia()
   return get_dia();
 }
 
+bool
+Uniform::get_dist_data(DistData& dd) const
+{
+  dd.type = DistData::uniform;
+  dd.p1 = m_diam;
+  return true;
+}
+
 void
 Normal::init(const std::string& a_prefix)
 {
@@ -54,6 +62,15 @@ Normal::get_avg_dia()
   return m_mean;
 }
 
+bool
+Normal::get_dist_data(DistData& dd) const
+{
+  dd.type = DistData::normal;
+  dd.p1 = m_mean;
+  dd.p2 = m_std;
+  return true;
+}
+
 void
 LogNormal::init(const amrex::Real& mean, const amrex::Real& std)
 {
@@ -85,6 +102,15 @@ LogNormal::get_avg_dia()
   return m_mean;
 }
 
+bool
+LogNormal::get_dist_data(DistData& dd) const
+{
+  dd.type = DistData::lognormal;
+  dd.p1 = m_log_mean;
+  dd.p2 = m_log_std;
+  return true;
+}
+
 void
 Weibull::init(const std::string& a_prefix)
 {
@@ -113,6 +139,15 @@ Weibull::get_avg_dia()
   return m_mean;
 }
 
+bool
+Weibull::get_dist_data(DistData& dd) const
+{
+  dd.type = DistData::weibull;
+  dd.p1 = m_mean;
+  dd.p2 = m_k;
+  return true;
+}
+
 void
 ChiSquared::init(const std::string& a_prefix)
 {
@@ -172,3 +207,12 @@ ChiSquared::get_avg_dia()
   }
   return curxi * dmean;
 }
+
+bool
+ChiSquared::get_dist_data(DistData& dd) const
+{
+  dd.type = DistData::chisquared;
+  dd.p1 = m_d32;
+  dd.rvals = rvals;
+  return true;
+}
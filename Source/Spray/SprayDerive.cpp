@@ -47,8 +47,7 @@ SprayParticleContainer::computeDerivedVars(
   const int vel_indx = nump_indx + 1;
   for (MyParIter pti(*this, level); pti.isValid(); ++pti) {
     const Long Np = pti.numParticles();
-    const AoS& pbox = pti.GetArrayOfStructs();
-    const ParticleType* pstruct = pbox().data();
+    const ConstSprayTileData ptd(pti.GetParticleTile());
     const SprayData* fdat = d_sprayData;
     FArrayBox& varfab = mf_var[pti];
     Array4<Real> const& vararr = mf_var.array(pti, start_indx);
@@ -65,7 +64,7 @@ SprayParticleContainer::computeDerivedVars(
     }
 #endif
     amrex::ParallelFor(Np, [=] AMREX_GPU_DEVICE(Long pid) noexcept {
-      const ParticleType& p = pstruct[pid];
+      const ConstSprayParcel p = ptd[pid];
       if (p.id() > 0) {
         RealVect lxc = (p.pos() - plo) * dxi;
         IntVect ijkc = lxc.floor(); // Cell with particle
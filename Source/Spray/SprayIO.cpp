@@ -3,11 +3,10 @@
 
 using namespace amrex;
 
-void
-SprayParticleContainer::SprayParticleIO(
-  const int level, const bool is_checkpoint, const std::string& dir)
+Vector<std::string>
+SprayParticleContainer::sprayCompNames()
 {
-  Vector<std::string> real_comp_names(NSR_SPR);
+  Vector<std::string> real_comp_names(SprayComps::pstateNum);
   AMREX_D_TERM(real_comp_names[SprayComps::pstateVel] = "xvel";
                , real_comp_names[SprayComps::pstateVel + 1] = "yvel";
                , real_comp_names[SprayComps::pstateVel + 2] = "zvel";);
@@ -30,6 +29,141 @@ SprayParticleContainer::SprayParticleIO(
     real_comp_names[SprayComps::pstateBM2] = "unused2";
   }
   real_comp_names[SprayComps::pstateFilmHght] = "wall_film_height";
+  real_comp_names[SprayComps::pstateDtSub] = "sub_dt";
+  return real_comp_names;
+}
+
+bool
+SprayParticleContainer::checkRestartComps(const std::string& dir)
+{
+  // The particle header lists the version, dimension, number of real
+  // components and their names
+  std::string header_name = dir + "/particles/Header";
+  if (!FileSystem::Exists(header_name)) {
+    return false;
+  }
+  Vector<char> fileCharPtr;
+  ParallelDescriptor::ReadAndBcastFile(header_name, fileCharPtr);
+  std::string fileCharPtrString(fileCharPtr.dataPtr());
+  std::istringstream header(fileCharPtrString, std::istringstream::in);
+  std::string version;
+  int in_dim = 0;
+  int in_nreal = 0;
+  header >> version >> in_dim >> in_nreal;
+  // Checkpoints written before the sub_dt component was added lack it as
+  // their last component
+  if (
+    in_nreal != SprayComps::pstateNum &&
+    in_nreal != SprayComps::pstateNum - 1) {
+    Abort(
+      "Spray checkpoint " + dir + " has " + std::to_string(in_nreal) +
+      " parcel components but " + std::to_string(SprayComps::pstateNum) +
+      " are expected; check SPRAY_FUEL_NUM");
+  }
+  Vector<std::string> comp_names = sprayCompNames();
+  for (int n = 0; n < in_nreal; ++n) {
+    std::string in_name;
+    header >> in_name;
+    if (
+      n >= SprayComps::pstateY && n < SprayComps::pstateY + SPRAY_FUEL_NUM &&
+      in_name != comp_names[n]) {
+      Abort(
+        "Spray checkpoint " + dir + " has fuel component " + in_name +
+        " where " + comp_names[n] + " is expected");
+    }
+  }
+  return in_nreal == SprayComps::pstateNum - 1;
+}
+
+void
+SprayParticleContainer::restartWithoutSubSteps(const std::string& dir)
+{
+  // Parcels as laid out before the sub_dt component was added
+#ifdef PELE_SPRAY_SOA
+  using OldPC = ParticleContainer<NSR_SPR, NSI_SPR, NAR_SPR - 1, NAI_SPR>;
+#else
+  using OldPC = ParticleContainer<NSR_SPR - 1, NSI_SPR, NAR_SPR, NAI_SPR>;
+#endif
+  constexpr int nold = SprayComps::pstateNum - 1;
+  OldPC old_pc(this->GetParGDB());
+  old_pc.Restart(dir, "particles");
+  for (int lev = 0; lev < static_cast<int>(old_pc.GetParticles().size());
+       ++lev) {
+    for (const auto& kv : old_pc.GetParticles(lev)) {
+      const auto& src = kv.second;
+      const Long np = src.numParticles();
+      if (np == 0) {
+        continue;
+      }
+      auto& dst = this->DefineAndReturnParticleTile(
+        lev, kv.first.first, kv.first.second);
+      dst.resize(np);
+      const SprayTileData ptd(dst);
+      const auto* src_aos = src.GetArrayOfStructs()().data();
+#ifdef PELE_SPRAY_SOA
+      GpuArray<const ParticleReal*, nold> src_rdata;
+      for (int n = 0; n < nold; ++n) {
+        src_rdata[n] = src.GetStructOfArrays().GetRealData(n).data();
+      }
+#endif
+      ParallelFor(np, [=] AMREX_GPU_DEVICE(Long pid) noexcept {
+        const auto& ps = src_aos[pid];
+        SprayParcel p = ptd[pid];
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          p.pos(dir) = ps.pos(dir);
+        }
+        p.id() = ps.id();
+        p.cpu() = ps.cpu();
+        for (int n = 0; n < nold; ++n) {
+#ifdef PELE_SPRAY_SOA
+          p.rdata(n) = src_rdata[n][pid];
+#else
+          p.rdata(n) = ps.rdata(n);
+#endif
+        }
+        p.rdata(SprayComps::pstateDtSub) = 0.;
+      });
+    }
+  }
+  Gpu::streamSynchronize();
+}
+
+int
+SprayParticleContainer::initFileComps(const std::string& fname)
+{
+  // The file starts with the number of parcels, followed by one line per
+  // parcel with its position and spray components
+  int ncomp = SprayComps::pstateNum;
+  if (ParallelDescriptor::IOProcessor()) {
+    std::ifstream ifs(fname.c_str());
+    if (!ifs.good()) {
+      FileOpenFailed(fname);
+    }
+    Long npart = 0;
+    ifs >> npart;
+    std::string line;
+    std::getline(ifs, line);
+    if (npart > 0 && std::getline(ifs, line)) {
+      std::istringstream iss(line);
+      Real val = 0.;
+      int nval = 0;
+      while (iss >> val) {
+        ++nval;
+      }
+      ncomp = nval - AMREX_SPACEDIM;
+    }
+  }
+  ParallelDescriptor::Bcast(&ncomp, 1, ParallelDescriptor::IOProcessorNumber());
+  return ncomp;
+}
+
+void
+SprayParticleContainer::SprayParticleIO(
+  const int level, const bool is_checkpoint, const std::string& dir)
+{
+  // Checkpoint writes the spray components in the same order whether they are
+  // stored in the particle struct or in the struct-of-arrays
+  Vector<std::string> real_comp_names = sprayCompNames();
   Vector<std::string> int_comp_names;
   Checkpoint(dir, "particles", is_checkpoint, real_comp_names, int_comp_names);
   // Here we write ascii information every time we write a plot file
@@ -45,6 +179,15 @@ SprayParticleContainer::SprayParticleIO(
     std::string fname = part_dir_path + "spray" + numstring + ".p3d";
     WriteAsciiFile(fname);
   }
+  // Binary parcel columns and sampling plane records go with the plot files
+  if (level == 0 && !is_checkpoint) {
+    if (SprayParticleContainer::write_binary_files) {
+      writeBinaryParticles(dir);
+    }
+    if (!m_samplePlanes.empty()) {
+      writeSamplePlanes(dir);
+    }
+  }
   // Since injection can occur over multiple time steps, we must write the
   // current status of each jet in a checkpoint to ensure injection isn't
   // interrupted during restart
@@ -97,6 +240,346 @@ SprayParticleContainer::SprayParticleIO(
   }
 }
 
+namespace {
+// Whether a parcel is written to the binary files. Parcels are picked by a
+// hash of their id and cpu, so the same parcels are written every time
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+bool
+keepBinaryParcel(
+  const ConstSprayParcel& p,
+  const Real frac,
+  const RealVect& blo,
+  const RealVect& bhi)
+{
+  for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+    if (p.pos(dir) < blo[dir] || p.pos(dir) > bhi[dir]) {
+      return false;
+    }
+  }
+  if (frac >= 1.) {
+    return true;
+  }
+  auto h = static_cast<std::uint64_t>(p.id()) * 0x9E3779B97F4A7C15ULL +
+           static_cast<std::uint64_t>(p.cpu());
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+  return static_cast<Real>(h >> 11) * 0x1.0p-53 < frac;
+}
+
+// Write one column of a binary file set. The file is created by the I/O
+// processor, and each rank writes its values at its offset in the column
+template <typename T>
+void
+writeBinaryColumn(
+  const std::string& fname, const Vector<T>& data, const Long offset)
+{
+  if (data.empty()) {
+    return;
+  }
+  std::fstream file(
+    fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  if (!file.good()) {
+    FileOpenFailed(fname);
+  }
+  file.seekp(static_cast<std::streamoff>(offset * sizeof(T)));
+  file.write(
+    reinterpret_cast<const char*>(data.data()),
+    static_cast<std::streamsize>(data.size() * sizeof(T)));
+  file.close();
+  if (!file.good()) {
+    Abort("Problem writing binary spray file " + fname);
+  }
+}
+
+// Write the columns of values to bin_dir, one file <name>.bin per column. The
+// Header lists the number of columns and values, then the name and the bytes
+// per value of each column. Values of a rank follow the values of the lower
+// ranks
+void
+writeBinaryColumns(
+  const std::string& bin_dir,
+  const Vector<std::string>& real_names,
+  const Vector<Vector<ParticleReal>>& real_cols,
+  const Vector<std::string>& int_names,
+  const Vector<Vector<Long>>& int_cols)
+{
+  const int nprocs = ParallelDescriptor::NProcs();
+  const int myproc = ParallelDescriptor::MyProc();
+  const Long nlocal = real_cols.empty()
+                        ? static_cast<Long>(int_cols[0].size())
+                        : static_cast<Long>(real_cols[0].size());
+  Vector<Long> counts(nprocs, 0);
+  counts[myproc] = nlocal;
+  ParallelDescriptor::ReduceLongSum(counts.data(), nprocs);
+  Long offset = 0;
+  Long total = 0;
+  for (int proc = 0; proc < nprocs; ++proc) {
+    if (proc < myproc) {
+      offset += counts[proc];
+    }
+    total += counts[proc];
+  }
+  if (ParallelDescriptor::IOProcessor()) {
+    if (!UtilCreateDirectory(bin_dir, 0755)) {
+      CreateDirectoryFailed(bin_dir);
+    }
+    std::string header_name = bin_dir + "/Header";
+    std::ofstream header(header_name.c_str(), std::ios::out | std::ios::trunc);
+    if (!header.good()) {
+      FileOpenFailed(header_name);
+    }
+    header << "PeleSprayBinary_v1\n"
+           << real_names.size() + int_names.size() << " " << total << "\n";
+    for (const auto& name : real_names) {
+      header << name << " " << sizeof(ParticleReal) << "\n";
+    }
+    for (const auto& name : int_names) {
+      header << name << " " << sizeof(Long) << "\n";
+    }
+    header.close();
+    if (!header.good()) {
+      Abort("Problem writing binary spray header " + header_name);
+    }
+    Vector<std::string> all_names(real_names);
+    all_names.insert(all_names.end(), int_names.begin(), int_names.end());
+    for (const auto& name : all_names) {
+      std::string fname = bin_dir + "/" + name + ".bin";
+      std::ofstream file(
+        fname.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+      if (!file.good()) {
+        FileOpenFailed(fname);
+      }
+    }
+  }
+  ParallelDescriptor::Barrier();
+  for (int n = 0; n < static_cast<int>(real_names.size()); ++n) {
+    writeBinaryColumn(
+      bin_dir + "/" + real_names[n] + ".bin", real_cols[n], offset);
+  }
+  for (int n = 0; n < static_cast<int>(int_names.size()); ++n) {
+    writeBinaryColumn(
+      bin_dir + "/" + int_names[n] + ".bin", int_cols[n], offset);
+  }
+  ParallelDescriptor::Barrier();
+}
+} // namespace
+
+void
+SprayParticleContainer::writeBinaryParticles(const std::string& dir)
+{
+  BL_PROFILE("SprayParticleContainer::writeBinaryParticles()");
+  constexpr int nreal = AMREX_SPACEDIM + SprayComps::pstateNum;
+  Vector<std::string> real_names(nreal);
+  AMREX_D_TERM(real_names[0] = "x";, real_names[1] = "y";
+               , real_names[2] = "z";);
+  Vector<std::string> comp_names = sprayCompNames();
+  for (int n = 0; n < SprayComps::pstateNum; ++n) {
+    real_names[AMREX_SPACEDIM + n] = comp_names[n];
+  }
+  Vector<std::string> int_names = {"id", "cpu"};
+  Vector<Vector<ParticleReal>> real_cols(nreal);
+  Vector<Vector<Long>> int_cols(2);
+  const Real frac = m_binaryFrac;
+  const RealVect blo = m_binaryLo;
+  const RealVect bhi = m_binaryHi;
+  for (int lev = 0; lev < static_cast<int>(this->GetParticles().size());
+       ++lev) {
+    for (const auto& kv : this->GetParticles(lev)) {
+      const auto& ptile = kv.second;
+      const int Np = static_cast<int>(ptile.numParticles());
+      if (Np == 0) {
+        continue;
+      }
+      const ConstSprayTileData ptd(ptile);
+      // Slot of each parcel kept among the parcels kept in the tile
+      Gpu::DeviceVector<int> keep_indx(Np);
+      int* kindx = keep_indx.data();
+      const int nkeep = Scan::PrefixSum<int>(
+        Np,
+        [=] AMREX_GPU_DEVICE(int pid) -> int {
+          ConstSprayParcel p = ptd[pid];
+          return (p.id() > 0 && keepBinaryParcel(p, frac, blo, bhi)) ? 1 : 0;
+        },
+        [=] AMREX_GPU_DEVICE(int pid, int const& s) { kindx[pid] = s; },
+        Scan::Type::exclusive, Scan::retSum);
+      if (nkeep == 0) {
+        continue;
+      }
+      // Columns of the parcels kept, one after the other
+      Gpu::DeviceVector<ParticleReal> real_d(static_cast<Long>(nkeep) * nreal);
+      Gpu::DeviceVector<Long> int_d(static_cast<Long>(nkeep) * 2);
+      ParticleReal* rvals = real_d.data();
+      Long* ivals = int_d.data();
+      ParallelFor(Np, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        ConstSprayParcel p = ptd[pid];
+        if (p.id() <= 0 || !keepBinaryParcel(p, frac, blo, bhi)) {
+          return;
+        }
+        const int k = kindx[pid];
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          rvals[static_cast<Long>(dir) * nkeep + k] = p.pos(dir);
+        }
+        for (int n = 0; n < SprayComps::pstateNum; ++n) {
+          rvals[static_cast<Long>(AMREX_SPACEDIM + n) * nkeep + k] =
+            p.rdata(n);
+        }
+        ivals[k] = static_cast<Long>(p.id());
+        ivals[nkeep + k] = static_cast<Long>(p.cpu());
+      });
+      Vector<ParticleReal> real_h(real_d.size());
+      Vector<Long> int_h(int_d.size());
+      Gpu::copy(
+        Gpu::deviceToHost, real_d.begin(), real_d.end(), real_h.begin());
+      Gpu::copy(Gpu::deviceToHost, int_d.begin(), int_d.end(), int_h.begin());
+      for (int n = 0; n < nreal; ++n) {
+        real_cols[n].insert(
+          real_cols[n].end(), real_h.begin() + static_cast<Long>(n) * nkeep,
+          real_h.begin() + static_cast<Long>(n + 1) * nkeep);
+      }
+      for (int n = 0; n < 2; ++n) {
+        int_cols[n].insert(
+          int_cols[n].end(), int_h.begin() + static_cast<Long>(n) * nkeep,
+          int_h.begin() + static_cast<Long>(n + 1) * nkeep);
+      }
+    }
+  }
+  writeBinaryColumns(
+    dir + "/spray_binary", real_names, real_cols, int_names, int_cols);
+}
+
+void
+SprayParticleContainer::samplePlanes(
+  const int Np,
+  const ParticleTileType& ptile,
+  const Real* pos_old,
+  const SprayPlane* planes,
+  const int nplanes,
+  const Real time,
+  const Real dt)
+{
+  BL_PROFILE("SprayParticleContainer::samplePlanes()");
+  const ConstSprayTileData ptd(ptile);
+  // Slot of the first record of each parcel among the records of the tile
+  Gpu::DeviceVector<int> rec_indx(Np);
+  int* rindx = rec_indx.data();
+  const int nrec = Scan::PrefixSum<int>(
+    Np,
+    [=] AMREX_GPU_DEVICE(int pid) -> int {
+      ConstSprayParcel p = ptd[pid];
+      if (p.id() <= 0) {
+        return 0;
+      }
+      const RealVect x0(AMREX_D_DECL(
+        pos_old[AMREX_SPACEDIM * pid], pos_old[AMREX_SPACEDIM * pid + 1],
+        pos_old[AMREX_SPACEDIM * pid + 2]));
+      int ncross = 0;
+      Real s = 0.;
+      for (int pl = 0; pl < nplanes; ++pl) {
+        if (planes[pl].crossed(x0, p.pos(), s)) {
+          ++ncross;
+        }
+      }
+      return ncross;
+    },
+    [=] AMREX_GPU_DEVICE(int pid, int const& s) { rindx[pid] = s; },
+    Scan::Type::exclusive, Scan::retSum);
+  if (nrec == 0) {
+    return;
+  }
+  // Records hold the crossing time and position, and the parcel state at the
+  // end of the update
+  constexpr int ncomp = SprayPlaneComps::num;
+  Gpu::DeviceVector<Real> recs_d(static_cast<Long>(nrec) * ncomp);
+  Real* recs = recs_d.data();
+  ParallelFor(Np, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+    ConstSprayParcel p = ptd[pid];
+    if (p.id() <= 0) {
+      return;
+    }
+    const RealVect x0(AMREX_D_DECL(
+      pos_old[AMREX_SPACEDIM * pid], pos_old[AMREX_SPACEDIM * pid + 1],
+      pos_old[AMREX_SPACEDIM * pid + 2]));
+    const RealVect x1 = p.pos();
+    int r = rindx[pid];
+    Real s = 0.;
+    for (int pl = 0; pl < nplanes; ++pl) {
+      if (!planes[pl].crossed(x0, x1, s)) {
+        continue;
+      }
+      Real* rec = recs + static_cast<Long>(r) * ncomp;
+      rec[SprayPlaneComps::plane] = static_cast<Real>(pl);
+      rec[SprayPlaneComps::time] = time + s * dt;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        rec[SprayPlaneComps::pos + dir] = x0[dir] + s * (x1[dir] - x0[dir]);
+        rec[SprayPlaneComps::vel + dir] = p.rdata(SprayComps::pstateVel + dir);
+      }
+      rec[SprayPlaneComps::dia] = p.rdata(SprayComps::pstateDia);
+      rec[SprayPlaneComps::temp] = p.rdata(SprayComps::pstateT);
+      for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+        rec[SprayPlaneComps::Y + spf] = p.rdata(SprayComps::pstateY + spf);
+      }
+      rec[SprayPlaneComps::numDens] = p.rdata(SprayComps::pstateNumDens);
+      ++r;
+    }
+  });
+  Vector<Real> recs_h(recs_d.size());
+  Gpu::copy(Gpu::deviceToHost, recs_d.begin(), recs_d.end(), recs_h.begin());
+#ifdef AMREX_USE_OMP
+#pragma omp critical(spray_planes)
+#endif
+  {
+    m_planeRecs.insert(m_planeRecs.end(), recs_h.begin(), recs_h.end());
+  }
+}
+
+void
+SprayParticleContainer::writeSamplePlanes(const std::string& dir)
+{
+  BL_PROFILE("SprayParticleContainer::writeSamplePlanes()");
+  constexpr int ncomp = SprayPlaneComps::num;
+  const int nplanes = static_cast<int>(m_samplePlanes.size());
+  Vector<std::string> names(ncomp - 1);
+  names[SprayPlaneComps::time - 1] = "time";
+  Vector<std::string> comp_names = sprayCompNames();
+  for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+    names[SprayPlaneComps::pos + dir - 1] = std::string(1, "xyz"[dir]);
+    names[SprayPlaneComps::vel + dir - 1] =
+      comp_names[SprayComps::pstateVel + dir];
+  }
+  names[SprayPlaneComps::dia - 1] = comp_names[SprayComps::pstateDia];
+  names[SprayPlaneComps::temp - 1] = comp_names[SprayComps::pstateT];
+  for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+    names[SprayPlaneComps::Y + spf - 1] = comp_names[SprayComps::pstateY + spf];
+  }
+  names[SprayPlaneComps::numDens - 1] = comp_names[SprayComps::pstateNumDens];
+  const std::string planes_dir = dir + "/spray_planes";
+  if (ParallelDescriptor::IOProcessor()) {
+    if (!UtilCreateDirectory(planes_dir, 0755)) {
+      CreateDirectoryFailed(planes_dir);
+    }
+  }
+  ParallelDescriptor::Barrier();
+  const Long nrecs = static_cast<Long>(m_planeRecs.size()) / ncomp;
+  Vector<Vector<Long>> no_int_cols;
+  for (int pl = 0; pl < nplanes; ++pl) {
+    Vector<Vector<ParticleReal>> cols(ncomp - 1);
+    for (Long r = 0; r < nrecs; ++r) {
+      const Real* rec = m_planeRecs.data() + r * ncomp;
+      if (static_cast<int>(rec[SprayPlaneComps::plane]) != pl) {
+        continue;
+      }
+      for (int n = 1; n < ncomp; ++n) {
+        cols[n - 1].push_back(static_cast<ParticleReal>(rec[n]));
+      }
+    }
+    writeBinaryColumns(
+      planes_dir + "/" + m_planeNames[pl], names, cols, {}, no_int_cols);
+  }
+  m_planeRecs.clear();
+}
+
 void
 SprayParticleContainer::PostInitRestart(const std::string& dir)
 {
@@ -0,0 +1,134 @@
+#include "SprayParticles.H"
+#include "SprayManage.H"
+#include <AMReX_DenseBins.H>
+
+using namespace amrex;
+
+void
+SprayParticleContainer::manageParcels(const int level)
+{
+  BL_PROFILE("SprayParticleContainer::manageParcels()");
+  if (m_parcelsPerCell <= 0 || level >= this->GetParticles().size()) {
+    return;
+  }
+  ParcelManageParms mp;
+  mp.ppc = m_parcelsPerCell;
+  mp.dia_tol = m_mergeDiaTol;
+  mp.temp_tol = m_mergeTempTol;
+  mp.vel_tol = m_mergeVelTol;
+  mp.split_num = m_splitParcelSize;
+  const int do_breakup = m_sprayData->do_breakup;
+  const auto dxiarr = this->Geom(level).InvCellSizeArray();
+  const auto dxarr = this->Geom(level).CellSizeArray();
+  const auto ploarr = this->Geom(level).ProbLoArray();
+  const RealVect dxi(AMREX_D_DECL(dxiarr[0], dxiarr[1], dxiarr[2]));
+  const RealVect dx(AMREX_D_DECL(dxarr[0], dxarr[1], dxarr[2]));
+  const RealVect plo(AMREX_D_DECL(ploarr[0], ploarr[1], ploarr[2]));
+  const int proc = ParallelDescriptor::MyProc();
+  // Parcels managed, merged away, and created by splitting
+  Gpu::DeviceVector<Long> stats_d(3, 0);
+  Long* stats = stats_d.data();
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+  {
+    for (MyParIter pti(*this, level); pti.isValid(); ++pti) {
+      const int Np = pti.numParticles();
+      if (Np == 0) {
+        continue;
+      }
+      auto& ptile = pti.GetParticleTile();
+      const SprayTileData ptd(ptile);
+      const SprayData* fdat = d_sprayData;
+      // Bin the parcels by cell of the tile and by merge bin in the cell.
+      // Wall film parcels are not managed and go to the last bin
+      const Box bx = pti.tilebox();
+      const int nobin = static_cast<int>(bx.numPts()) * parcel_merge_bins;
+      Gpu::DeviceVector<int> pcell(Np);
+      int* cell = pcell.data();
+      ParallelFor(Np, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        SprayParcel p = ptd[pid];
+        const IntVect ijkc = ((p.pos() - plo) * dxi).floor();
+        cell[pid] =
+          (p.id() > 0 && p.rdata(SprayComps::pstateFilmHght) <= 0. &&
+           bx.contains(ijkc))
+            ? static_cast<int>(bx.index(ijkc)) * parcel_merge_bins +
+                mergeBin(p, mp)
+            : nobin;
+      });
+      DenseBins<int> bins;
+      bins.build(
+        Np, cell, nobin + 1,
+        [=] AMREX_GPU_DEVICE(const int& c) noexcept -> unsigned int {
+          return static_cast<unsigned int>(c);
+        });
+      const auto* perm = bins.permutationPtr();
+      const auto* offsets = bins.offsetsPtr();
+      Gpu::DeviceVector<int> nsplit_d(Np, 0);
+      int* nsplit = nsplit_d.data();
+      ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+        const auto* cell_offsets =
+          offsets + bx.index(IntVect(AMREX_D_DECL(i, j, k))) *
+                      parcel_merge_bins;
+        const int beg = static_cast<int>(cell_offsets[0]);
+        const int end = static_cast<int>(cell_offsets[parcel_merge_bins]);
+        if (beg == end) {
+          return;
+        }
+        const auto counts = manageCellParcels(
+          perm, cell_offsets, mp, *fdat, do_breakup, ptd, nsplit);
+        HostDevice::Atomic::Add(&stats[0], static_cast<Long>(end - beg));
+        HostDevice::Atomic::Add(&stats[1], static_cast<Long>(counts[0]));
+        HostDevice::Atomic::Add(&stats[2], static_cast<Long>(counts[1]));
+      });
+      if (mp.split_num <= 0.) {
+        Gpu::streamSynchronize();
+        continue;
+      }
+      // Slot of the first copy of each split parcel among the new parcels
+      Gpu::DeviceVector<int> copy_indx(Np);
+      int* cindx = copy_indx.data();
+      const int ncopy = Scan::PrefixSum<int>(
+        Np, [=] AMREX_GPU_DEVICE(int pid) -> int { return nsplit[pid]; },
+        [=] AMREX_GPU_DEVICE(int pid, int const& s) { cindx[pid] = s; },
+        Scan::Type::exclusive, Scan::retSum);
+      if (ncopy == 0) {
+        continue;
+      }
+      // Tiles are updated by several threads, reserve the ids of all copies
+      Long first_id = 0;
+#ifdef AMREX_USE_OMP
+#pragma omp critical(spray_manage_ids)
+#endif
+      {
+        first_id = ParticleType::NextID();
+        ParticleType::NextID(first_id + ncopy);
+      }
+      const Long first_copy = ptile.numParticles();
+      ptile.resize(first_copy + ncopy);
+      const SprayTileData ptd_new(ptile);
+      ParallelForRNG(
+        Np, [=] AMREX_GPU_DEVICE(int pid, RandomEngine const& engine) noexcept {
+          if (nsplit[pid] > 0) {
+            splitParcel(
+              pid, nsplit[pid], do_breakup, ptd_new, first_copy + cindx[pid],
+              first_id + cindx[pid], proc, plo, dx, engine);
+          }
+        });
+      Gpu::streamSynchronize();
+    }
+  }
+  if (m_verbose > 1) {
+    Vector<Long> stats_h(3);
+    Gpu::copy(
+      Gpu::deviceToHost, stats_d.begin(), stats_d.end(), stats_h.begin());
+    ParallelDescriptor::ReduceLongSum(
+      stats_h.data(), 3, ParallelDescriptor::IOProcessorNumber());
+    if (ParallelDescriptor::IOProcessor()) {
+      Print() << "Spray parcels on level " << level << ": " << stats_h[0]
+              << " managed, " << stats_h[1] << " merged, " << stats_h[2]
+              << " created by splitting, "
+              << stats_h[0] - stats_h[1] + stats_h[2] << " after" << std::endl;
+    }
+  }
+}
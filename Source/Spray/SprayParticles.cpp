@@ -7,12 +7,31 @@
 #include "TABBreakup.H"
 #include "ReitzKHRT.H"
 #include "WallFilm.H"
+#include "SprayDeposit.H"
+#include "SprayCollision.H"
 #ifdef AMREX_USE_EB
 #include <AMReX_EBFArrayBox.H>
 #endif
 
 using namespace amrex;
 
+// Substep statistics: parcels binned by number of substeps, 1, 2, 3-4, 5-8,
+// ..., and more than 64, followed by the total substeps and subcycles
+constexpr int sub_nbins = 8;
+constexpr int sub_nstats = sub_nbins + 2;
+
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+int
+subStepBin(const int nsub)
+{
+  int bin = 0;
+  for (int m = 1; m < nsub && bin < sub_nbins - 1; m *= 2) {
+    ++bin;
+  }
+  return bin;
+}
+
 void
 SprayParticleContainer::init_bcs()
 {
@@ -36,6 +55,55 @@ SprayParticleContainer::init_bcs()
   }
 }
 
+bool
+SprayParticleContainer::storeHostParcel(
+  const ParticleType& p, const Real* pvals, HostParcelMap& host_parts)
+{
+  ParticleLocData pld;
+  if (!Where(p, pld)) {
+    return false;
+  }
+  HostParcels& hp = host_parts[std::make_pair(pld.m_grid, pld.m_tile)];
+  hp.aos.push_back(p);
+#ifdef PELE_SPRAY_SOA
+  for (int n = 0; n < NAR_SPR; ++n) {
+    hp.soa[n].push_back(pvals[n]);
+  }
+#else
+  for (int n = 0; n < NSR_SPR; ++n) {
+    hp.aos.back().rdata(n) = pvals[n];
+  }
+#endif
+  return true;
+}
+
+void
+SprayParticleContainer::addHostParcels(
+  const int level, HostParcelMap& host_parts)
+{
+  for (auto& kv : host_parts) {
+    const HostParcels& src = kv.second;
+    auto& dst_tile = GetParticles(level)[kv.first];
+    const auto old_size = dst_tile.GetArrayOfStructs().size();
+    dst_tile.resize(old_size + src.aos.size());
+    // Copy the AoS part of the host particles to the GPU
+    Gpu::copyAsync(
+      Gpu::hostToDevice, src.aos.begin(), src.aos.end(),
+      dst_tile.GetArrayOfStructs().begin() + old_size);
+#ifdef PELE_SPRAY_SOA
+    // And the spray components stored in the SoA
+    auto& soa = dst_tile.GetStructOfArrays();
+    for (int n = 0; n < NAR_SPR; ++n) {
+      Gpu::copyAsync(
+        Gpu::hostToDevice, src.soa[n].begin(), src.soa[n].end(),
+        soa.GetRealData(n).begin() + old_size);
+    }
+#endif
+  }
+  Gpu::streamSynchronize();
+  host_parts.clear();
+}
+
 void
 SprayParticleContainer::moveKick(
   MultiFab& state,
@@ -83,6 +151,12 @@ SprayParticleContainer::moveKickDrift(
     return;
   }
 
+  // Parcels are merged or split before the update that moves them, when they
+  // are in the cells of their tiles
+  if (do_move && !isVirtualPart && !isGhostPart) {
+    manageParcels(level);
+  }
+
   updateParticles(
     level, state, source, dt, time, state_ghosts, source_ghosts, isVirtualPart,
     isGhostPart, do_move, ltransparm, spray_cfl_lev);
@@ -108,12 +182,11 @@ SprayParticleContainer::estTimestep(int level) const
 #endif
     {
       for (MyParConstIter pti(*this, level); pti.isValid(); ++pti) {
-        const AoS& pbox = pti.GetArrayOfStructs();
-        const ParticleType* pstruct = pbox().data();
-        const int n = pbox.numParticles();
+        const ConstSprayTileData ptd(pti.GetParticleTile());
+        const int n = pti.numParticles();
         reduce_op.eval(
           n, reduce_data, [=] AMREX_GPU_DEVICE(const int i) -> ReduceTuple {
-            const ParticleType& p = pstruct[i];
+            const ConstSprayParcel p = ptd[i];
             if (p.id() > 0) {
               const Real max_mag_vdx = amrex::max(AMREX_D_DECL(
                 std::abs(p.rdata(SprayComps::pstateVel)) * dxi[0],
@@ -147,7 +220,7 @@ SprayParticleContainer::updateParticles(
   MultiFab& state,
   MultiFab& source,
   const Real& flow_dt,
-  const Real& /*time*/,
+  const Real& time,
   const int state_ghosts,
   const int source_ghosts,
   const bool isVirt,
@@ -164,6 +237,9 @@ SprayParticleContainer::updateParticles(
   bool isActive = !(isVirt || isGhost);
   bool do_splash = (m_sprayData->do_splash && isActive && do_move);
   bool do_breakup = (m_sprayData->do_breakup > 0);
+  bool do_collision = (m_sprayData->do_collision && isActive && do_move);
+  const int nplanes = static_cast<int>(m_samplePlanes.size());
+  bool do_planes = (nplanes > 0 && isActive && do_move);
   Real B0 = m_khrtB0;
   Real B1 = m_khrtB1;
   Real C3 = m_khrtC3;
@@ -239,14 +315,52 @@ SprayParticleContainer::updateParticles(
         injN * std::pow(injDia, 3) / static_cast<Real>(numJets);
     }
   }
+  // Substep statistics of the active parcels
+  const bool sub_stats = (m_verbose > 1 && isActive);
+  Gpu::DeviceVector<Long> sub_stats_d;
+  if (sub_stats) {
+    sub_stats_d.resize(sub_nstats, 0);
+  }
+  Long* sub_hist = sub_stats_d.data();
+  // Coalescences and grazing collisions of the active parcels
+  Gpu::DeviceVector<Long> coll_stats_d;
+  if (sub_stats && do_collision) {
+    coll_stats_d.resize(2, 0);
+  }
+  Long* coll_stats = coll_stats_d.data();
+  // Sampling planes crossed by the active parcels
+  Gpu::DeviceVector<SprayPlane> planes_d;
+  if (do_planes) {
+    planes_d.resize(nplanes);
+    Gpu::copy(
+      Gpu::hostToDevice, m_samplePlanes.begin(), m_samplePlanes.end(),
+      planes_d.begin());
+  }
+  const SprayPlane* planes = planes_d.data();
+  // Molecular weights of the gas species in spray units
+  GpuArray<Real, NUM_SPECIES> gas_mw;
+  {
+    auto eos = pele::physics::PhysicsType::eos();
+    SprayUnits SPU;
+    eos.molecular_weight(gas_mw.data());
+    for (int n = 0; n < NUM_SPECIES; ++n) {
+      gas_mw[n] *= SPU.mass_conv;
+    }
+  }
   // Particle components indices
   SprayComps SPI = m_sprayIndx;
+  const bool sort_dep = m_sortDeposit && Gpu::inLaunchRegion();
+  const bool private_dep = m_sortDeposit && Gpu::notInLaunchRegion();
   // Start the ParIter, which loops over separate sets of particles in different
   // boxes
 #ifdef AMREX_USE_OMP
 #pragma omp parallel if (Gpu::notInLaunchRegion())
 #endif
   {
+    // Private source tile of the thread for deposition without atomics
+    FArrayBox dep_fab;
+    // Cell-centered gas state of the tile, shared by its parcels
+    FArrayBox gas_fab;
     for (MyParIter pti(*this, level); pti.isValid(); ++pti) {
       const Box tile_box = pti.tilebox();
       const Box src_box = pti.growntilebox(source_ghosts);
@@ -256,18 +370,61 @@ SprayParticleContainer::updateParticles(
       if (Np == 0) {
         continue;
       }
-      AoS& pbox = pti.GetArrayOfStructs();
-      ParticleType* pstruct = pbox().data();
+      const SprayTileData ptd(pti.GetParticleTile());
       const SprayData* fdat = d_sprayData;
+      // Collisions over the whole update, before the parcels leave the cells
+      // of the tile
+      if (do_collision) {
+        collideTileParcels(
+          Np, ptd, tile_box, plo, dxi, flow_dt, fdat, coll_stats);
+      }
       Array4<const Real> const& Tarr = state.array(pti, SPI.utempIndx);
       Array4<const Real> const& rhoYarr = state.array(pti, SPI.specIndx);
       Array4<const Real> const& rhoarr = state.array(pti, SPI.rhoIndx);
       Array4<const Real> const& momarr = state.array(pti, SPI.momIndx);
       Array4<const Real> const& engarr = state.array(pti, SPI.engIndx);
-      Array4<Real> const& rhoYSrcarr = source.array(pti, SPI.specSrcIndx);
-      Array4<Real> const& rhoSrcarr = source.array(pti, SPI.rhoSrcIndx);
-      Array4<Real> const& momSrcarr = source.array(pti, SPI.momSrcIndx);
-      Array4<Real> const& engSrcarr = source.array(pti, SPI.engSrcIndx);
+      // Cache the gas state of the tile when its parcels gather more stencil
+      // cells than it has cells
+      const bool cache_gas = static_cast<Long>(Np) * num_iter *
+                               AMREX_D_PICK(2, 4, 8) >
+                             state_box.numPts();
+      Array4<const Real> gasarr;
+      if (cache_gas) {
+        gas_fab.resize(state_box, SprayGasComps::num, The_Async_Arena());
+        Array4<Real> const& gas_arr = gas_fab.array();
+        ParallelFor(
+          state_box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+            CacheGasCell(
+              IntVect(AMREX_D_DECL(i, j, k)), gas_arr, rhoarr, rhoYarr, Tarr,
+              momarr, engarr, gas_mw);
+          });
+        gasarr = gas_fab.const_array();
+      }
+      Array4<Real> rhoYSrcarr = source.array(pti, SPI.specSrcIndx);
+      Array4<Real> rhoSrcarr = source.array(pti, SPI.rhoSrcIndx);
+      Array4<Real> momSrcarr = source.array(pti, SPI.momSrcIndx);
+      Array4<Real> engSrcarr = source.array(pti, SPI.engSrcIndx);
+      // Cells the parcels of this tile can deposit sources to
+      Box dep_box = source[pti].box();
+      SprayDeposit spray_dep;
+      SprayDepositRecs dep_recs;
+      if (sort_dep) {
+        // Record the sources of each parcel and subcycle, then sum them by
+        // cell after the parcel update
+        spray_dep.define(dep_box, Np * num_iter);
+        dep_recs = spray_dep.recs();
+      } else if (private_dep) {
+        // Deposit to the private source tile and merge it into source after
+        // the parcel update
+        dep_box = src_box;
+        dep_fab.resize(dep_box, SprayDepComps::num, The_Async_Arena());
+        dep_fab.setVal<RunOn::Host>(0.);
+        Array4<Real> const& dep_arr = dep_fab.array();
+        momSrcarr = Array4<Real>(dep_arr, SprayDepComps::mom, AMREX_SPACEDIM);
+        rhoSrcarr = Array4<Real>(dep_arr, SprayDepComps::mass, 1);
+        rhoYSrcarr = Array4<Real>(dep_arr, SprayDepComps::spec, SPRAY_FUEL_NUM);
+        engSrcarr = Array4<Real>(dep_arr, SprayDepComps::eng, 1);
+      }
       bool eb_in_box = false;
 
 #ifdef AMREX_USE_EB
@@ -301,40 +458,42 @@ SprayParticleContainer::updateParticles(
         // TODO: Adjust this for EB faces
         Real face_area = AMREX_D_TERM(dx[0], *dx[1], *dx[2]);
         amrex::ParallelFor(Np, [=] AMREX_GPU_DEVICE(int pid) noexcept {
-          ParticleType& p = pstruct[pid];
+          SprayParcel p = ptd[pid];
           if (p.id() > 0 && p.rdata(SprayComps::pstateFilmHght) > 0.) {
             fillFilmFab(wf_arr, p, face_area, plo, dx);
           }
         });
       }
       // Data structures for creating new particles during splashing/breakup
-      Gpu::HostVector<splash_breakup> N_SB_h;
       Gpu::DeviceVector<splash_breakup> N_SB_d;
       SBVects refv;
       SBPtrs rf_d;
       bool make_new_drops =
         ((do_breakup || do_splash_box) && isActive && do_move);
       if (make_new_drops) {
-        N_SB_h.assign(Np, splash_breakup::no_change);
-        N_SB_d.resize(Np);
-        Gpu::copyAsync(
-          Gpu::hostToDevice, N_SB_h.begin(), N_SB_h.end(), N_SB_d.begin());
+        N_SB_d.resize(Np, splash_breakup::no_change);
         refv.build(Np);
         refv.fillPtrs_d(rf_d);
       }
       auto* N_SB = N_SB_d.dataPtr();
+      // Positions at the start of the update, to find the planes crossed
+      Gpu::DeviceVector<Real> pos_old_d;
+      if (do_planes) {
+        pos_old_d.resize(static_cast<Long>(Np) * AMREX_SPACEDIM);
+      }
+      Real* pos_old = pos_old_d.data();
       amrex::ParallelFor(Np, [=] AMREX_GPU_DEVICE(int pid) noexcept {
-        ParticleType& p = pstruct[pid];
+        SprayParcel p = ptd[pid];
         if (p.id() > 0) {
-          auto eos = pele::physics::PhysicsType::eos();
-          SprayUnits SPU;
+          if (pos_old != nullptr) {
+            for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+              pos_old[AMREX_SPACEDIM * pid + dir] = p.pos(dir);
+            }
+          }
           GasPhaseVals gpv;
           GpuArray<Real, SPRAY_FUEL_NUM>
             cBoilT; // Boiling temperature at current pressure
-          eos.molecular_weight(gpv.mw.data());
-          for (int n = 0; n < NUM_SPECIES; ++n) {
-            gpv.mw[n] *= SPU.mass_conv;
-          }
+          gpv.mw = gas_mw;
           GpuArray<IntVect, AMREX_D_PICK(2, 4, 8)>
             indx_array; // array of adjacent cells
           GpuArray<Real, AMREX_D_PICK(2, 4, 8)>
@@ -355,42 +514,80 @@ SprayParticleContainer::updateParticles(
           // Used for ETAB breakup model
           Real Utan_total = 0.;
           Real Reyn_d = 0.;
+          // Subcycles of this parcel: as many as its own CFL number needs, up
+          // to the subcycles of the level. Wall film parcels keep the
+          // subcycles of the level
+          int p_iter = num_iter;
+          if (num_iter > 1 && p.rdata(SprayComps::pstateFilmHght) <= 0.) {
+            Real p_cfl = 0.;
+            for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+              p_cfl = amrex::max(
+                p_cfl, amrex::Math::abs(p.rdata(SprayComps::pstateVel + dir)) *
+                         dxi[dir]);
+            }
+            p_iter = amrex::min(
+              num_iter, amrex::max(
+                          1, static_cast<int>(
+                               std::ceil(p_cfl * flow_dt / sub_cfl))));
+          }
+          const Real p_sub_dt = flow_dt / static_cast<Real>(p_iter);
+          int p_nsub = 0;
+          // Flag for whether we are near EB boundaries
+          bool do_fe_interp = false;
+          // The gas state at the parcel only changes when the parcel moves,
+          // and the stencil cells only when it moves to another stencil
+          bool interp_gas = true;
+          bool new_stencil = true;
           // Subcycle loop
-          for (int cur_iter = 0; cur_iter < num_iter && p.id() > 0;
+          for (int cur_iter = 0; cur_iter < p_iter && p.id() > 0;
                ++cur_iter) {
             bool is_film = false;
             // Gather wall film values
             if (p.rdata(SprayComps::pstateFilmHght) > 0.) {
               is_film = true;
             }
-            // Flag for whether we are near EB boundaries
-            bool do_fe_interp = false;
+            if (interp_gas) {
 #ifdef AMREX_USE_EB
-            if (eb_in_box) {
-              do_fe_interp = eb_interp(
-                p, ijkc, ijk, dx, dxi, lx, plo, bflags, flags_array, ccent_fab,
-                bcent_fab, bnorm_fab, volfrac_fab, fdat->min_eb_vfrac,
-                indx_array.data(), weights.data());
-            } else
+              if (eb_in_box) {
+                do_fe_interp = eb_interp(
+                  p, ijkc, ijk, dx, dxi, lx, plo, bflags, flags_array,
+                  ccent_fab, bcent_fab, bnorm_fab, volfrac_fab,
+                  fdat->min_eb_vfrac, indx_array.data(), weights.data());
+              } else
 #endif
-            {
-              trilinear_interp(
-                ijk, lx, indx_array.data(), weights.data(), bflags);
+              {
+                if (new_stencil) {
+                  trilinear_cells(ijk, indx_array.data());
+                }
+                trilinear_weights(ijk, lx, weights.data(), bflags);
+              }
+              // Interpolate fluid state
+              gpv.reset();
+              if (cache_gas) {
+                InterpolateCachedGasPhase(
+                  gpv, state_box, gasarr, indx_array.data(), weights.data());
+                gpv.defineFromInvMW();
+              } else {
+                InterpolateGasPhase(
+                  gpv, state_box, rhoarr, rhoYarr, Tarr, momarr, engarr,
+                  indx_array.data(), weights.data());
+                // Solve for avg mw and pressure at droplet location
+                gpv.define();
+              }
+              fdat->calcBoilT(gpv, cBoilT.data());
+              interp_gas = false;
+              new_stencil = false;
+            } else {
+              gpv.resetSources();
             }
-            // Interpolate fluid state
-            gpv.reset();
-            InterpolateGasPhase(
-              gpv, state_box, rhoarr, rhoYarr, Tarr, momarr, engarr,
-              indx_array.data(), weights.data());
-            // Solve for avg mw and pressure at droplet location
-            gpv.define();
-            fdat->calcBoilT(gpv, cBoilT.data());
             if (is_film) {
               calculateFilmSource(
-                sub_dt, gpv, *fdat, p, cBoilT.data(), ltransparm);
+                p_sub_dt, gpv, *fdat, p, cBoilT.data(), ltransparm);
+              ++p_nsub;
             } else {
               Reyn_d = calculateSpraySource(
-                sub_dt, gpv, *fdat, p, cBoilT.data(), ltransparm);
+                p_sub_dt, gpv, *fdat, p, cBoilT.data(), ltransparm);
+              p_nsub += gpv.num_sub;
             }
             IntVect cur_indx = ijkc;
             Real cvol = inv_vol;
@@ -398,9 +595,9 @@ SprayParticleContainer::updateParticles(
               // Update breakup variables and determine if breakup occurs
               if (fdat->do_breakup == 1) {
                 Utan_total += updateBreakupTAB(
-                  Reyn_d, sub_dt, cBoilT.data(), gpv, *fdat, p);
+                  Reyn_d, p_sub_dt, cBoilT.data(), gpv, *fdat, p);
               }
-              if (cur_iter == num_iter - 1) {
+              if (cur_iter == p_iter - 1) {
                 if (fdat->do_breakup == 1 && make_new_drops) {
                   // Determine if parcel must be split into multiple parcels
                   splitDropletTAB(pid, p, max_ppp, N_SB, rf_d, Utan_total);
@@ -418,35 +615,52 @@ SprayParticleContainer::updateParticles(
               cvol *= 1. / (volfrac_fab(cur_indx));
             }
 #endif
-            Real cur_coef = -cvol * sub_dt / flow_dt;
+            Real cur_coef = -cvol * p_sub_dt / flow_dt;
             if (!src_box.contains(cur_indx)) {
               if (!isGhost) {
                 Abort("SprayParticleContainer::updateParticles() -- source box "
                       "too small");
               }
             }
-            if (fdat->mom_trans) {
+            if (dep_recs.active()) {
+              Real* dep =
+                dep_recs.record(pid * num_iter + cur_iter, cur_indx);
               for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
-                Gpu::Atomic::Add(
-                  &momSrcarr(cur_indx, dir), cur_coef * gpv.fluid_mom_src[dir]);
+                dep[SprayDepComps::mom + dir] =
+                  cur_coef * gpv.fluid_mom_src[dir];
               }
-            }
-            if (fdat->mass_trans) {
-              Gpu::Atomic::Add(
-                &rhoSrcarr(cur_indx), cur_coef * gpv.fluid_mass_src);
+              dep[SprayDepComps::mass] = cur_coef * gpv.fluid_mass_src;
               for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+                dep[SprayDepComps::spec + spf] =
+                  cur_coef * gpv.fluid_Y_dot[spf];
+              }
+              dep[SprayDepComps::eng] = cur_coef * gpv.fluid_eng_src;
+            } else if (dep_box.contains(cur_indx)) {
+              if (fdat->mom_trans) {
+                for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+                  Gpu::Atomic::Add(
+                    &momSrcarr(cur_indx, dir),
+                    cur_coef * gpv.fluid_mom_src[dir]);
+                }
+              }
+              if (fdat->mass_trans) {
                 Gpu::Atomic::Add(
-                  &rhoYSrcarr(cur_indx, spf), cur_coef * gpv.fluid_Y_dot[spf]);
+                  &rhoSrcarr(cur_indx), cur_coef * gpv.fluid_mass_src);
+                for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+                  Gpu::Atomic::Add(
+                    &rhoYSrcarr(cur_indx, spf),
+                    cur_coef * gpv.fluid_Y_dot[spf]);
+                }
               }
+              Gpu::Atomic::Add(
+                &engSrcarr(cur_indx), cur_coef * gpv.fluid_eng_src);
             }
-            Gpu::Atomic::Add(
-              &engSrcarr(cur_indx), cur_coef * gpv.fluid_eng_src);
             // Real new_time = static_cast<Real>(cur_iter + 1) * sub_dt;
             // Modify particle position by whole time step
             if (do_move && !fdat->fixed_parts && p.id() > 0 && !is_film) {
               for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
                 const Real cvel = p.rdata(SprayComps::pstateVel + dir);
-                p.pos(dir) += sub_dt * cvel;
+                p.pos(dir) += p_sub_dt * cvel;
               }
               if (at_bounds || do_fe_interp) {
                 // First check if particle has exited the domain through a
@@ -471,8 +685,11 @@ SprayParticleContainer::updateParticles(
                 }
               } // if (at_bounds || fe_interp)
               // Update indices
+              interp_gas = true;
               lx = (p.pos() - plo) * dxi + 0.5;
-              ijk = lx.floor();
+              const IntVect ijk_new = lx.floor();
+              new_stencil = (ijk_new != ijk);
+              ijk = ijk_new;
               lxc = (p.pos() - plo) * dxi;
               ijkc = lxc.floor(); // New cell center
             }
@@ -480,25 +697,88 @@ SprayParticleContainer::updateParticles(
               p.id() = -1;
             }
           } // End of subcycle loop
+          if (sub_stats) {
+            HostDevice::Atomic::Add(&sub_hist[subStepBin(p_nsub)], Long(1));
+            HostDevice::Atomic::Add(&sub_hist[sub_nbins], Long(p_nsub));
+            HostDevice::Atomic::Add(&sub_hist[sub_nbins + 1], Long(p_iter));
+          }
         } // End of p.id() > 0 check
       }); // End of loop over particles
-      if (make_new_drops) {
-        Gpu::copy(
-          Gpu::deviceToHost, N_SB_d.begin(), N_SB_d.end(), N_SB_h.begin());
-        bool get_new_parts = false;
-        for (int n = 0; n < Np; n++) {
-          if (N_SB_h[n] != splash_breakup::no_change) {
-            get_new_parts = true;
-          }
+      if (sort_dep) {
+        spray_dep.deposit(
+          momSrcarr, rhoSrcarr, rhoYSrcarr, engSrcarr,
+          m_sprayData->mom_trans, m_sprayData->mass_trans);
+      } else if (private_dep) {
+        // Tiles overlap in their ghost cells, so merge atomically
+        FArrayBox& srcfab = source[pti];
+        if (m_sprayData->mom_trans) {
+          srcfab.atomicAdd<RunOn::Host>(
+            dep_fab, dep_box, dep_box, SprayDepComps::mom, SPI.momSrcIndx,
+            AMREX_SPACEDIM);
         }
-        if (get_new_parts) {
-          refv.retrieve_data();
-          SBPtrs rfh;
-          refv.fillPtrs_h(rfh);
-          CreateSBDroplets(Np, sub_dt, N_SB_h.data(), rfh, level);
+        if (m_sprayData->mass_trans) {
+          srcfab.atomicAdd<RunOn::Host>(
+            dep_fab, dep_box, dep_box, SprayDepComps::mass, SPI.rhoSrcIndx, 1);
+          srcfab.atomicAdd<RunOn::Host>(
+            dep_fab, dep_box, dep_box, SprayDepComps::spec, SPI.specSrcIndx,
+            SPRAY_FUEL_NUM);
         }
+        srcfab.atomicAdd<RunOn::Host>(
+          dep_fab, dep_box, dep_box, SprayDepComps::eng, SPI.engSrcIndx, 1);
+      }
+      if (do_planes) {
+        samplePlanes(
+          Np, pti.GetParticleTile(), pos_old, planes, nplanes, time, flow_dt);
+      }
+      if (make_new_drops) {
+        CreateSBDroplets(Np, sub_dt, N_SB, rf_d, pti.GetParticleTile());
       }
       Gpu::streamSynchronize();
     } // for (int MyParIter pti..
   }
+  if (sub_stats) {
+    Vector<Long> sub_stats_h(sub_nstats);
+    Gpu::copy(
+      Gpu::deviceToHost, sub_stats_d.begin(), sub_stats_d.end(),
+      sub_stats_h.begin());
+    ParallelDescriptor::ReduceLongSum(
+      sub_stats_h.data(), sub_nstats, ParallelDescriptor::IOProcessorNumber());
+    Long npart = 0;
+    for (int b = 0; b < sub_nbins; ++b) {
+      npart += sub_stats_h[b];
+    }
+    if (npart > 0 && ParallelDescriptor::IOProcessor()) {
+      const Real np_inv = 1. / static_cast<Real>(npart);
+      Print() << "Spray substeps on level " << level << ": " << npart
+              << " parcels, "
+              << static_cast<Real>(sub_stats_h[sub_nbins + 1]) * np_inv
+              << " subcycles and "
+              << static_cast<Real>(sub_stats_h[sub_nbins]) * np_inv
+              << " substeps per parcel\n  parcels by substeps:";
+      for (int b = 0; b < sub_nbins; ++b) {
+        const int lo = (b < 2) ? b + 1 : (1 << (b - 1)) + 1;
+        Print() << " " << lo;
+        if (b == sub_nbins - 1) {
+          Print() << "+";
+        } else if (b > 1) {
+          Print() << "-" << (1 << b);
+        }
+        Print() << ": " << sub_stats_h[b];
+      }
+      Print() << std::endl;
+    }
+  }
+  if (sub_stats && do_collision) {
+    Vector<Long> coll_stats_h(2);
+    Gpu::copy(
+      Gpu::deviceToHost, coll_stats_d.begin(), coll_stats_d.end(),
+      coll_stats_h.begin());
+    ParallelDescriptor::ReduceLongSum(
+      coll_stats_h.data(), 2, ParallelDescriptor::IOProcessorNumber());
+    if (ParallelDescriptor::IOProcessor()) {
+      Print() << "Spray collisions on level " << level << ": "
+              << coll_stats_h[0] << " coalescences, " << coll_stats_h[1]
+              << " grazing" << std::endl;
+    }
+  }
 }
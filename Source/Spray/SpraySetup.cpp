@@ -11,12 +11,27 @@ SprayData* SprayParticleContainer::d_sprayData = nullptr;
 SprayComps SprayParticleContainer::m_sprayIndx;
 Real SprayParticleContainer::spray_cfl = 0.5;
 bool SprayParticleContainer::write_ascii_files = false;
+bool SprayParticleContainer::write_binary_files = false;
+Real SprayParticleContainer::m_binaryFrac = 1.;
+RealVect SprayParticleContainer::m_binaryLo(
+  AMREX_D_DECL(-1.E100, -1.E100, -1.E100));
+RealVect SprayParticleContainer::m_binaryHi(
+  AMREX_D_DECL(1.E100, 1.E100, 1.E100));
+Vector<std::string> SprayParticleContainer::m_planeNames;
+Vector<SprayPlane> SprayParticleContainer::m_samplePlanes;
 bool SprayParticleContainer::plot_spray_src = false;
+bool SprayParticleContainer::m_sortDeposit = false;
+bool SprayParticleContainer::m_deviceInject = false;
 Real SprayParticleContainer::m_maxNumPPP = 100.;
 Real SprayParticleContainer::m_breakupPPPFact = 0.5;
 Real SprayParticleContainer::m_khrtB0 = 0.61;
 Real SprayParticleContainer::m_khrtB1 = 7.;
 Real SprayParticleContainer::m_khrtC3 = 1.;
+int SprayParticleContainer::m_parcelsPerCell = 0;
+Real SprayParticleContainer::m_mergeDiaTol = 0.1;
+Real SprayParticleContainer::m_mergeTempTol = 5.;
+Real SprayParticleContainer::m_mergeVelTol = 0.1;
+Real SprayParticleContainer::m_splitParcelSize = 0.;
 std::string SprayParticleContainer::spray_init_file;
 
 void
@@ -185,6 +200,14 @@ SprayParticleContainer::readSprayParams(int& particle_verbose)
     m_sprayData->do_breakup = breakup_model;
   }
 
+  //
+  // Set if droplet collisions are modeled, which needs the surface tension
+  //
+  pp.query("use_collision_model", m_sprayData->do_collision);
+  if (m_sprayData->do_collision) {
+    pp.get("fuel_sigma", m_sprayData->sigma);
+  }
+
   // Must use same reference temperature for all fuels
   pp.get("fuel_ref_temp", spray_ref_T);
   //
@@ -192,10 +215,79 @@ SprayParticleContainer::readSprayParams(int& particle_verbose)
   //
   pp.query("write_ascii_files", write_ascii_files);
   //
+  // Set if binary files of the parcels should be written, and the fraction
+  // and region of the parcels written
+  //
+  pp.query("write_binary_files", write_binary_files);
+  pp.query("binary_fraction", m_binaryFrac);
+  if (m_binaryFrac <= 0. || m_binaryFrac > 1.) {
+    Abort("'binary_fraction' must be greater than 0 and at most 1");
+  }
+  std::vector<Real> binary_lo;
+  std::vector<Real> binary_hi;
+  if (pp.queryarr("binary_lo", binary_lo) != 0) {
+    m_binaryLo = RealVect(binary_lo);
+  }
+  if (pp.queryarr("binary_hi", binary_hi) != 0) {
+    m_binaryHi = RealVect(binary_hi);
+  }
+  //
+  // Set the sampling planes recording the parcels that cross them, each
+  // given by a point and a normal
+  //
+  m_planeNames.clear();
+  m_samplePlanes.clear();
+  std::vector<std::string> plane_names;
+  pp.queryarr("sampling_planes", plane_names);
+  for (const auto& plane_name : plane_names) {
+    ParmParse ppl("particles." + plane_name);
+    std::vector<Real> point;
+    std::vector<Real> normal;
+    ppl.getarr("point", point);
+    ppl.getarr("normal", normal);
+    SprayPlane plane;
+    plane.point = RealVect(point);
+    plane.normal = RealVect(normal);
+    const Real norm_mag = plane.normal.vectorLength();
+    if (norm_mag <= 0.) {
+      Abort("Normal of sampling plane " + plane_name + " must not be zero");
+    }
+    plane.normal /= norm_mag;
+    m_planeNames.push_back(plane_name);
+    m_samplePlanes.push_back(plane);
+  }
+  //
   // Set if gas phase spray source term should be written
   //
   pp.query("plot_src", plot_spray_src);
   //
+  // Set if gas phase sources are deposited without atomics, by sorting the
+  // deposits by cell on GPU or with private source tiles on CPU
+  //
+  pp.query("sort_deposit", m_sortDeposit);
+  //
+  // Set if parcels of jets are sampled and injected on device
+  //
+  pp.query("device_injection", m_deviceInject);
+  //
+  // Set the target number of parcels per cell and the limits of parcel
+  // merging and splitting
+  //
+  pp.query("parcels_per_cell", m_parcelsPerCell);
+  if (m_parcelsPerCell > 0) {
+    pp.query("merge_dia_tol", m_mergeDiaTol);
+    pp.query("merge_temp_tol", m_mergeTempTol);
+    pp.query("merge_vel_tol", m_mergeVelTol);
+    pp.query("split_parcel_size", m_splitParcelSize);
+    if (
+      m_mergeDiaTol <= 0. || m_mergeTempTol <= 0. || m_mergeVelTol <= 0.) {
+      Abort("Parcel merging tolerances must be positive");
+    }
+    if (m_splitParcelSize > 0. && m_splitParcelSize < 2.) {
+      Abort("'split_parcel_size' must be at least 2");
+    }
+  }
+  //
   // Used in initData() on startup to read in a file of particles.
   //
   pp.query("init_file", spray_init_file);
@@ -296,6 +388,16 @@ SprayParticleContainer::spraySetup(const Real* body_force)
   ParallelDescriptor::Barrier();
 }
 
+void
+SprayParticleContainer::distributeJets()
+{
+  const int nprocs = ParallelDescriptor::NProcs();
+  int numjets = static_cast<int>(m_sprayJets.size());
+  for (int jindx = 0; jindx < numjets; ++jindx) {
+    m_sprayJets[jindx]->set_default_proc(jindx % nprocs);
+  }
+}
+
 void
 SprayParticleContainer::SprayInitialize(const std::string& restart_dir)
 {
@@ -304,10 +406,35 @@ SprayParticleContainer::SprayInitialize(const std::string& restart_dir)
     init_sprays = true;
   }
   InitSprayParticles(init_sprays);
+  distributeJets();
   if (!spray_init_file.empty()) {
-    InitFromAsciiFile(spray_init_file, NSR_SPR);
+    // Init files may omit the last component, sub_dt, which always starts at
+    // zero
+    const int init_comps = initFileComps(spray_init_file);
+    if (
+      init_comps != SprayComps::pstateNum &&
+      init_comps != SprayComps::pstateNum - 1) {
+      Abort(
+        "Spray init file " + spray_init_file + " has " +
+        std::to_string(init_comps) + " parcel components but " +
+        std::to_string(SprayComps::pstateNum) + " are expected");
+    }
+    InitFromAsciiFile(spray_init_file, init_comps);
+    for (int lev = 0; lev <= finestLevel(); ++lev) {
+      for (MyParIter pti(*this, lev); pti.isValid(); ++pti) {
+        const SprayTileData ptd(pti.GetParticleTile());
+        ParallelFor(
+          pti.numParticles(), [=] AMREX_GPU_DEVICE(Long pid) noexcept {
+            ptd[pid].rdata(SprayComps::pstateDtSub) = 0.;
+          });
+      }
+    }
   } else if (!restart_dir.empty()) {
-    Restart(restart_dir, "particles");
+    if (checkRestartComps(restart_dir)) {
+      restartWithoutSubSteps(restart_dir);
+    } else {
+      Restart(restart_dir, "particles");
+    }
   }
   PostInitRestart(restart_dir);
 }
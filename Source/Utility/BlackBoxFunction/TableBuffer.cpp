@@ -0,0 +1,157 @@
+#include <AMReX.H>
+#include <AMReX_Arena.H>
+#include <AMReX_ParallelDescriptor.H>
+#include "TableBuffer.H"
+
+#include <algorithm>
+#include <fstream>
+
+#if !defined(AMREX_USE_GPU) && defined(__has_include)
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define PELE_TABLE_USE_MMAP
+#endif
+#endif
+
+namespace pele::physics {
+
+struct TableBuffer::SharedWindow
+{
+#if defined(AMREX_USE_MPI) && !defined(AMREX_USE_GPU)
+  MPI_Comm comm{MPI_COMM_NULL};
+  MPI_Win win{MPI_WIN_NULL};
+#endif
+};
+
+TableBuffer*
+TableBuffer::allocate_pinned(std::size_t bytes)
+{
+  auto* buf = new TableBuffer;
+  buf->m_kind = Kind::pinned;
+  buf->m_size = bytes;
+  buf->m_data = amrex::The_Pinned_Arena()->alloc(bytes);
+  return buf;
+}
+
+TableBuffer*
+TableBuffer::map_file(
+  const std::string& fname, std::size_t offset, std::size_t bytes)
+{
+#ifdef PELE_TABLE_USE_MMAP
+  auto* buf = new TableBuffer;
+  buf->m_kind = Kind::mapped;
+  buf->m_size = bytes;
+  buf->m_writer = false;
+  const int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    amrex::Abort("TableBuffer: unable to open " + fname);
+  }
+  // The mapping must start on a page boundary
+  const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t map_offset = offset - offset % page;
+  buf->m_map_len = bytes + (offset - map_offset);
+  void* base = mmap(
+    nullptr, buf->m_map_len, PROT_READ, MAP_SHARED, fd,
+    static_cast<off_t>(map_offset));
+  close(fd);
+  if (base == MAP_FAILED) {
+    amrex::Abort("TableBuffer: unable to map " + fname);
+  }
+  buf->m_map_base = base;
+  buf->m_data = static_cast<char*>(base) + (offset - map_offset);
+  // The pages are shared by all processes mapping the file
+  buf->m_nshared = amrex::ParallelDescriptor::NProcsPerNode();
+  return buf;
+#else
+  amrex::ignore_unused(fname, offset, bytes);
+  amrex::Abort("TableBuffer: memory mapped tables are only available for CPU "
+               "builds on POSIX systems");
+  return nullptr;
+#endif
+}
+
+TableBuffer*
+TableBuffer::allocate_shared(std::size_t bytes)
+{
+#if defined(AMREX_USE_MPI) && !defined(AMREX_USE_GPU)
+  auto* buf = new TableBuffer;
+  buf->m_kind = Kind::shared;
+  buf->m_size = bytes;
+  buf->m_window = new SharedWindow;
+  MPI_Comm& comm = buf->m_window->comm;
+  MPI_Comm_split_type(
+    amrex::ParallelDescriptor::Communicator(), MPI_COMM_TYPE_SHARED,
+    amrex::ParallelDescriptor::MyProc(), MPI_INFO_NULL, &comm);
+  int node_rank = 0;
+  MPI_Comm_rank(comm, &node_rank);
+  MPI_Comm_size(comm, &buf->m_nshared);
+  buf->m_writer = (node_rank == 0);
+
+  // Rank 0 of the node owns all the memory, the others attach to it
+  void* ptr = nullptr;
+  const auto local_bytes = static_cast<MPI_Aint>(
+    buf->m_writer ? std::max<std::size_t>(bytes, 1) : 0);
+  MPI_Win_allocate_shared(
+    local_bytes, 1, MPI_INFO_NULL, comm, &ptr, &buf->m_window->win);
+  MPI_Aint shared_bytes = 0;
+  int disp_unit = 0;
+  MPI_Win_shared_query(
+    buf->m_window->win, 0, &shared_bytes, &disp_unit, &buf->m_data);
+  // Open an access epoch for the writer
+  MPI_Win_fence(0, buf->m_window->win);
+  return buf;
+#else
+  // Without MPI (or on GPUs) every rank holds its own copy
+  return allocate_pinned(bytes);
+#endif
+}
+
+void
+TableBuffer::sync()
+{
+#if defined(AMREX_USE_MPI) && !defined(AMREX_USE_GPU)
+  if (m_kind == Kind::shared) {
+    MPI_Win_fence(0, m_window->win);
+  }
+#endif
+}
+
+TableBuffer::~TableBuffer()
+{
+  switch (m_kind) {
+  case Kind::pinned:
+    amrex::The_Pinned_Arena()->free(m_data);
+    break;
+  case Kind::mapped:
+#ifdef PELE_TABLE_USE_MMAP
+    munmap(m_map_base, m_map_len);
+#endif
+    break;
+  case Kind::shared:
+#if defined(AMREX_USE_MPI) && !defined(AMREX_USE_GPU)
+    MPI_Win_free(&m_window->win);
+    MPI_Comm_free(&m_window->comm);
+#endif
+    break;
+  }
+  delete m_window;
+}
+
+std::size_t
+TableBuffer::resident_bytes()
+{
+#ifdef PELE_TABLE_USE_MMAP
+  // Second entry of statm is the resident set size in pages (Linux only)
+  std::ifstream statm("/proc/self/statm");
+  std::size_t size = 0;
+  std::size_t resident = 0;
+  if (statm >> size >> resident) {
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  }
+#endif
+  return 0;
+}
+
+} // namespace pele::physics
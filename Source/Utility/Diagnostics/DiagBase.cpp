@@ -1,5 +1,6 @@
 #include "DiagBase.H"
 #include "AMReX_ParmParse.H"
+#include <AMReX.H>
 
 void
 DiagBase::init(const std::string& a_prefix, std::string_view a_diagName)
@@ -92,3 +93,15 @@ DiagBase::getFieldIndex(
   }
   return index;
 }
+
+DiagContext&
+DiagBase::context()
+{
+  // Built on first use and released with AMReX, before the arenas
+  static std::unique_ptr<DiagContext> ctx;
+  if (!ctx) {
+    ctx = std::make_unique<DiagContext>();
+    amrex::ExecOnFinalize([]() { ctx.reset(); });
+  }
+  return *ctx;
+}
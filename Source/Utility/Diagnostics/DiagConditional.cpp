@@ -19,14 +19,31 @@ DiagConditional::init(const std::string& a_prefix, std::string_view a_diagName)
   } else {
     amrex::Abort("Unknown conditional_type: " + condType);
   }
-  pp.get("nBins", m_nBins);
-  AMREX_ASSERT(m_nBins > 0);
-  pp.get("condition_field_name", m_cFieldName);
+  // One condition field, or two for statistics conditioned on joint bins
+  pp.getarr("condition_field_name", m_cFieldNames);
+  const int nCond = static_cast<int>(m_cFieldNames.size());
+  if (nCond < 1 || nCond > 2) {
+    amrex::Abort("DiagConditional: one or two condition_field_name expected");
+  }
+  m_nCondBins.resize(nCond);
+  const int nBinsCount = pp.countval("nBins");
+  AMREX_ALWAYS_ASSERT(nBinsCount == 1 || nBinsCount == nCond);
+  m_nBins = 1;
+  for (int c{0}; c < nCond; ++c) {
+    pp.get("nBins", m_nCondBins[c], nBinsCount == 1 ? 0 : c);
+    AMREX_ASSERT(m_nCondBins[c] > 0);
+    m_nBins *= m_nCondBins[c];
+  }
+  m_lowBnd.resize(nCond, 0.0);
+  m_highBnd.resize(nCond, 0.0);
   if (pp.countval("range") != 0) {
+    AMREX_ALWAYS_ASSERT(pp.countval("range") == 2 * nCond);
     amrex::Vector<amrex::Real> range{0.0};
-    pp.getarr("range", range, 0, 2);
-    m_lowBnd = std::min(range[0], range[1]);
-    m_highBnd = std::max(range[0], range[1]);
+    pp.getarr("range", range, 0, 2 * nCond);
+    for (int c{0}; c < nCond; ++c) {
+      m_lowBnd[c] = std::min(range[2 * c], range[2 * c + 1]);
+      m_highBnd[c] = std::max(range[2 * c], range[2 * c + 1]);
+    }
     m_usecFieldMinMax = false;
   }
   int nProcessFields = -1;
@@ -43,7 +60,9 @@ void
 DiagConditional::addVars(amrex::Vector<std::string>& a_varList)
 {
   DiagBase::addVars(a_varList);
-  a_varList.push_back(m_cFieldName);
+  for (const auto& v : m_cFieldNames) {
+    a_varList.push_back(v);
+  }
   for (const auto& v : m_fieldNames) {
     a_varList.push_back(v);
   }
@@ -88,168 +107,124 @@ DiagConditional::processDiag(
   const amrex::Vector<const amrex::MultiFab*>& a_state,
   const amrex::Vector<std::string>& a_stateVar)
 {
-  // Set conditional range
-  int cFieldIdx = getFieldIndex(m_cFieldName, a_stateVar);
-  if (m_usecFieldMinMax) {
-    m_lowBnd = MFVecMin(a_state, cFieldIdx);
-    m_highBnd = MFVecMax(a_state, cFieldIdx);
+  // Set conditional ranges and binning
+  const int nCond = static_cast<int>(m_cFieldNames.size());
+  amrex::Vector<DiagBinData> hostBins(nCond);
+  for (int c{0}; c < nCond; ++c) {
+    hostBins[c].m_varIdx = getFieldIndex(m_cFieldNames[c], a_stateVar);
+    if (m_usecFieldMinMax) {
+      m_lowBnd[c] = MFVecMin(a_state, hostBins[c].m_varIdx);
+      m_highBnd[c] = MFVecMax(a_state, hostBins[c].m_varIdx);
+    }
+    hostBins[c].m_nBins = m_nCondBins[c];
+    hostBins[c].m_lowBnd = m_lowBnd[c];
+    hostBins[c].m_binWidth =
+      (m_highBnd[c] - m_lowBnd[c]) / static_cast<amrex::Real>(m_nCondBins[c]);
   }
-  amrex::Real binWidth =
-    (m_highBnd - m_lowBnd) / static_cast<amrex::Real>(m_nBins);
+  amrex::Gpu::DeviceVector<DiagBinData> bins_d(nCond);
+  amrex::Gpu::copy(
+    amrex::Gpu::hostToDevice, hostBins.begin(), hostBins.end(),
+    bins_d.begin());
 
-  // Data holders
+  // All the statistics of a bin are accumulated in a single sweep, stored
+  // contiguously as: the (volume weighted) fields, their squares (Average),
+  // the volume (Average) and the volume weighted condition fields
   int nProcessFields = static_cast<int>(m_fieldIndices_d.size());
-  int vecSize = m_nBins * nProcessFields;
-  amrex::Gpu::DeviceVector<amrex::Real> cond_d(vecSize, 0.0);
-  amrex::Gpu::DeviceVector<amrex::Real> condSq_d(vecSize, 0.0);
-  amrex::Gpu::DeviceVector<amrex::Real> condAbs_d(m_nBins, 0.0);
-  amrex::Gpu::DeviceVector<amrex::Real> condVol_d(m_nBins, 0.0);
-  amrex::Vector<amrex::Real> cond(vecSize, 0.0);
-  amrex::Vector<amrex::Real> condSq(vecSize, 0.0);
-  amrex::Vector<amrex::Real> condAbs(m_nBins, 0.0);
-  amrex::Vector<amrex::Real> condVol(m_nBins, 0.0);
+  const bool average = (m_condType == Average);
+  const bool sum = (m_condType == Sum);
+  const int sqIdx = nProcessFields;
+  const int volIdx = sqIdx + (average ? nProcessFields : 0);
+  const int absIdx = volIdx + (average ? 1 : 0);
+  const int nVals = absIdx + nCond;
+  amrex::Gpu::DeviceVector<amrex::Real> hist_d(m_nBins * nVals, 0.0);
+  amrex::Vector<amrex::Real> hist(m_nBins * nVals, 0.0);
 
   // Populate the data from each level on each proc
   for (int lev = 0; lev < a_state.size(); ++lev) {
 
-    // Make mask tagging fine-covered and filtered cells
-    amrex::iMultiFab mask;
-    if (lev == a_state.size() - 1) {
-      mask.define(
-        a_state[lev]->boxArray(), a_state[lev]->DistributionMap(), 1,
-        amrex::IntVect(0));
-      mask.setVal(1);
-    } else {
-      mask = amrex::makeFineMask(
-        *a_state[lev], *a_state[lev + 1], amrex::IntVect(0), m_refRatio[lev],
-        amrex::Periodicity::NonPeriodic(), 1, 0);
-    }
+    // Fine-covered cells mask and volumes are cached by the context,
+    // filters are checked on the fly
+    const auto& ba = a_state[lev]->boxArray();
+    const auto& dm = a_state[lev]->DistributionMap();
+    const bool finest = (lev == a_state.size() - 1);
+    const auto& mask = context().fineMask(
+      lev, ba, dm, finest ? nullptr : &a_state[lev + 1]->boxArray(),
+      finest ? amrex::IntVect(1) : m_refRatio[lev]);
     auto const& sarrs = a_state[lev]->const_arrays();
-    auto const& marrs = mask.arrays();
+    auto const& marrs = mask.const_arrays();
     auto* fdata_p = m_filterData.data();
-    amrex::ParallelFor(
-      *a_state[lev], amrex::IntVect(0),
-      [=, nFilters = m_filters.size()] AMREX_GPU_DEVICE(
-        int box_no, int i, int j, int k) noexcept {
-        for (int f{0}; f < nFilters; ++f) {
-          amrex::Real fval = sarrs[box_no](i, j, k, fdata_p[f].m_filterVarIdx);
-          if (fval < fdata_p[f].m_low_val || fval > fdata_p[f].m_high_val) {
-            marrs[box_no](i, j, k) = 0;
-          }
-        }
-      });
-    amrex::Gpu::streamSynchronize();
+    const int nFilters = static_cast<int>(m_filters.size());
 
     // Get the geometry volume to account for 2D-RZ
-    amrex::MultiFab volume(
-      a_state[lev]->boxArray(), a_state[lev]->DistributionMap(), 1, 0);
-    m_geoms[lev].GetVolume(volume);
+    const auto& volume = context().volume(lev, m_geoms[lev], ba, dm);
     auto const& varrs = volume.const_arrays();
 
-    auto* cond_d_p = cond_d.dataPtr();
-    auto* condAbs_d_p = condAbs_d.dataPtr();
+    auto* bins_p = bins_d.data();
     auto* idx_d_p = m_fieldIndices_d.dataPtr();
-    if (m_condType == Average) {
-      auto* condSq_d_p = condSq_d.dataPtr();
-      auto* condVol_d_p = condVol_d.dataPtr();
-      amrex::ParallelFor(
-        *a_state[lev], amrex::IntVect(0),
-        [=, nBins = m_nBins, lowBnd = m_lowBnd] AMREX_GPU_DEVICE(
-          int box_no, int i, int j, int k) noexcept {
-          if (marrs[box_no](i, j, k) != 0) {
-            int cbin = static_cast<int>(std::floor(
-              (sarrs[box_no](i, j, k, cFieldIdx) - lowBnd) / binWidth));
-            if (cbin >= 0 && cbin < nBins) {
-              for (int f{0}; f < nProcessFields; ++f) {
-                int fidx = idx_d_p[f];
-                int binOffset = f * nBins;
-                amrex::HostDevice::Atomic::Add(
-                  &(cond_d_p[binOffset + cbin]),
-                  varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, fidx));
-                amrex::HostDevice::Atomic::Add(
-                  &(condSq_d_p[binOffset + cbin]),
-                  varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, fidx) *
-                    sarrs[box_no](i, j, k, fidx));
-              }
-              amrex::HostDevice::Atomic::Add(
-                &(condVol_d_p[cbin]), varrs[box_no](i, j, k));
-              amrex::HostDevice::Atomic::Add(
-                &(condAbs_d_p[cbin]),
-                varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, cFieldIdx));
-            }
-          }
-        });
-    } else if (m_condType == Integral) {
-      amrex::ParallelFor(
-        *a_state[lev], amrex::IntVect(0),
-        [=, nBins = m_nBins, lowBnd = m_lowBnd] AMREX_GPU_DEVICE(
-          int box_no, int i, int j, int k) noexcept {
-          if (marrs[box_no](i, j, k) != 0) {
-            int cbin = static_cast<int>(std::floor(
-              (sarrs[box_no](i, j, k, cFieldIdx) - lowBnd) / binWidth));
-            if (cbin >= 0 && cbin < nBins) {
-              for (int f{0}; f < nProcessFields; ++f) {
-                int fidx = idx_d_p[f];
-                int binOffset = f * nBins;
-                amrex::HostDevice::Atomic::Add(
-                  &(cond_d_p[binOffset + cbin]),
-                  varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, fidx));
-              }
-              amrex::HostDevice::Atomic::Add(
-                &(condAbs_d_p[cbin]),
-                varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, cFieldIdx));
-            }
-          }
-        });
-    } else if (m_condType == Sum) {
-      amrex::ParallelFor(
-        *a_state[lev], amrex::IntVect(0),
-        [=, nBins = m_nBins, lowBnd = m_lowBnd] AMREX_GPU_DEVICE(
-          int box_no, int i, int j, int k) noexcept {
-          if (marrs[box_no](i, j, k) != 0) {
-            int cbin = static_cast<int>(std::floor(
-              (sarrs[box_no](i, j, k, cFieldIdx) - lowBnd) / binWidth));
-            if (cbin >= 0 && cbin < nBins) {
-              for (int f{0}; f < nProcessFields; ++f) {
-                int fidx = idx_d_p[f];
-                int binOffset = f * nBins;
-                amrex::HostDevice::Atomic::Add(
-                  &(cond_d_p[binOffset + cbin]), sarrs[box_no](i, j, k, fidx));
-              }
-              amrex::HostDevice::Atomic::Add(
-                &(condAbs_d_p[cbin]),
-                varrs[box_no](i, j, k) * sarrs[box_no](i, j, k, cFieldIdx));
-            }
-          }
-        });
-    }
-    amrex::Gpu::streamSynchronize();
+    diagHistogramAccumulate(
+      *a_state[lev], m_nBins, nVals, 1, hist_d.data(),
+      [=] AMREX_GPU_HOST_DEVICE(
+        int box_no, int i, int j, int k, int /*g*/) noexcept {
+        if (
+          marrs[box_no](i, j, k) == 0 ||
+          !diagFiltersPass(fdata_p, nFilters, sarrs[box_no], i, j, k)) {
+          return -1;
+        }
+        int b = diagBinIndex(bins_p[0], sarrs[box_no], i, j, k);
+        if (b >= 0 && nCond > 1) {
+          const int b1 = diagBinIndex(bins_p[1], sarrs[box_no], i, j, k);
+          b = (b1 >= 0) ? b + bins_p[0].m_nBins * b1 : -1;
+        }
+        return b;
+      },
+      [=] AMREX_GPU_HOST_DEVICE(
+        int box_no, int i, int j, int k, int v) noexcept {
+        const amrex::Real vol = varrs[box_no](i, j, k);
+        if (v < sqIdx) {
+          const amrex::Real val = sarrs[box_no](i, j, k, idx_d_p[v]);
+          return sum ? val : vol * val;
+        }
+        if (v < volIdx) {
+          const amrex::Real val = sarrs[box_no](i, j, k, idx_d_p[v - sqIdx]);
+          return vol * val * val;
+        }
+        if (v < absIdx) {
+          return vol;
+        }
+        return vol * sarrs[box_no](i, j, k, bins_p[v - absIdx].m_varIdx);
+      });
   }
-
-  amrex::Gpu::copy(
-    amrex::Gpu::deviceToHost, cond_d.begin(), cond_d.end(), cond.begin());
   amrex::Gpu::streamSynchronize();
-  amrex::ParallelDescriptor::ReduceRealSum(
-    cond.data(), static_cast<int>(cond.size()));
+
   amrex::Gpu::copy(
-    amrex::Gpu::deviceToHost, condAbs_d.begin(), condAbs_d.end(),
-    condAbs.begin());
+    amrex::Gpu::deviceToHost, hist_d.begin(), hist_d.end(), hist.begin());
   amrex::Gpu::streamSynchronize();
   amrex::ParallelDescriptor::ReduceRealSum(
-    condAbs.data(), static_cast<int>(condAbs.size()));
-  if (m_condType == Average) {
-    amrex::Gpu::copy(
-      amrex::Gpu::deviceToHost, condVol_d.begin(), condVol_d.end(),
-      condVol.begin());
-    amrex::Gpu::streamSynchronize();
-    amrex::ParallelDescriptor::ReduceRealSum(
-      condVol.data(), static_cast<int>(condVol.size()));
-    amrex::Gpu::copy(
-      amrex::Gpu::deviceToHost, condSq_d.begin(), condSq_d.end(),
-      condSq.begin());
-    amrex::Gpu::streamSynchronize();
-    amrex::ParallelDescriptor::ReduceRealSum(
-      condSq.data(), static_cast<int>(condSq.size()));
+    hist.data(), static_cast<int>(hist.size()));
+
+  // Unpack the histogram
+  int vecSize = m_nBins * nProcessFields;
+  amrex::Vector<amrex::Real> cond(vecSize, 0.0);
+  amrex::Vector<amrex::Real> condSq(vecSize, 0.0);
+  amrex::Vector<amrex::Real> condAbs(m_nBins * nCond, 0.0);
+  amrex::Vector<amrex::Real> condVol(m_nBins, 0.0);
+  for (int n{0}; n < m_nBins; ++n) {
+    const amrex::Real* h = hist.data() + static_cast<std::size_t>(n) * nVals;
+    for (int f{0}; f < nProcessFields; ++f) {
+      cond[f * m_nBins + n] = h[f];
+      if (average) {
+        condSq[f * m_nBins + n] = h[sqIdx + f];
+      }
+    }
+    if (average) {
+      condVol[n] = h[volIdx];
+    }
+    for (int c{0}; c < nCond; ++c) {
+      condAbs[c * m_nBins + n] = h[absIdx + c];
+    }
+  }
+
+  if (average) {
     for (int f{0}; f < nProcessFields; ++f) {
       int binOffset = f * m_nBins;
       for (int n{0}; n < m_nBins; ++n) {
@@ -259,9 +234,11 @@ DiagConditional::processDiag(
         }
       }
     }
-    for (int n{0}; n < m_nBins; ++n) {
-      if (condVol[n] != 0.0) {
-        condAbs[n] /= condVol[n];
+    for (int c{0}; c < nCond; ++c) {
+      for (int n{0}; n < m_nBins; ++n) {
+        if (condVol[n] != 0.0) {
+          condAbs[c * m_nBins + n] /= condVol[n];
+        }
       }
     }
   }
@@ -304,6 +281,29 @@ DiagConditional::MFVecMax(
   return mmax;
 }
 
+std::string
+DiagConditional::fileName(int a_nstep, const amrex::Real& a_time) const
+{
+  std::string diagfile;
+  if (m_interval > 0) {
+    diagfile = amrex::Concatenate(m_diagfile, a_nstep, 6);
+  }
+  if (m_per > 0.0) {
+    diagfile = m_diagfile + std::to_string(a_time);
+  }
+  return diagfile + ".dat";
+}
+
+amrex::Real
+DiagConditional::binCenter(int a_c, int a_n) const
+{
+  // Bins of the first condition field vary fastest
+  const int nc = (a_c == 0) ? a_n % m_nCondBins[0] : a_n / m_nCondBins[0];
+  const amrex::Real binWidth = (m_highBnd[a_c] - m_lowBnd[a_c]) /
+                               static_cast<amrex::Real>(m_nCondBins[a_c]);
+  return m_lowBnd[a_c] + (nc + 0.5) * binWidth;
+}
+
 void
 DiagConditional::writeAverageDataToFile(
   int a_nstep,
@@ -313,56 +313,63 @@ DiagConditional::writeAverageDataToFile(
   const amrex::Vector<amrex::Real>& a_condSq,
   const amrex::Vector<amrex::Real>& a_condVol)
 {
-  std::string diagfile;
-  if (m_interval > 0) {
-    diagfile = amrex::Concatenate(m_diagfile, a_nstep, 6);
-  }
-  if (m_per > 0.0) {
-    diagfile = m_diagfile + std::to_string(a_time);
-  }
-  diagfile = diagfile + ".dat";
+  const std::string diagfile = fileName(a_nstep, a_time);
 
   if (amrex::ParallelDescriptor::IOProcessor()) {
     std::ofstream condFile;
     condFile.open(diagfile.c_str(), std::ios::out);
     const int prec = 8;
     const int width = 16;
+    const int nCond = static_cast<int>(m_cFieldNames.size());
     const int nProcessFields = static_cast<int>(m_fieldIndices_d.size());
-    amrex::Vector<int> widths(3 + 2 * nProcessFields, width);
+    amrex::Vector<int> widths(2 * nCond + 1 + 2 * nProcessFields, width);
 
-    condFile << std::left << std::setw(widths[0]) << "BinCenter"
-             << " ";
-    widths[1] = std::max(width, static_cast<int>(m_cFieldName.length()) + 1);
-    condFile << std::left << std::setw(widths[1]) << m_cFieldName << " ";
-    condFile << std::left << std::setw(widths[2]) << "Volume"
+    for (int c{0}; c < nCond; ++c) {
+      const std::string center =
+        (nCond == 1) ? "BinCenter" : "BinCenter_" + m_cFieldNames[c];
+      widths[c] = std::max(width, static_cast<int>(center.length()) + 1);
+      condFile << std::left << std::setw(widths[c]) << center << " ";
+    }
+    for (int c{0}; c < nCond; ++c) {
+      widths[nCond + c] =
+        std::max(width, static_cast<int>(m_cFieldNames[c].length()) + 1);
+      condFile << std::left << std::setw(widths[nCond + c]) << m_cFieldNames[c]
+               << " ";
+    }
+    const int volCol = 2 * nCond;
+    condFile << std::left << std::setw(widths[volCol]) << "Volume"
              << " ";
     for (int f{0}; f < nProcessFields; ++f) {
-      widths[3 + 2 * f] =
+      widths[volCol + 1 + 2 * f] =
         std::max(width, static_cast<int>(m_fieldNames[f].length()) + 5);
-      condFile << std::left << std::setw(widths[3 + 2 * f])
+      condFile << std::left << std::setw(widths[volCol + 1 + 2 * f])
                << m_fieldNames[f] + "_Avg" << " ";
-      widths[4 + 2 * f] =
+      widths[volCol + 2 + 2 * f] =
         std::max(width, static_cast<int>(m_fieldNames[f].length()) + 7);
-      condFile << std::left << std::setw(widths[4 + 2 * f])
+      condFile << std::left << std::setw(widths[volCol + 2 + 2 * f])
                << m_fieldNames[f] + "_StdDev" << " ";
     }
     condFile << "\n";
 
-    // Retrieve some data
-    amrex::Real binWidth = (m_highBnd - m_lowBnd) / (m_nBins);
-
     for (int n{0}; n < m_nBins; ++n) {
-      condFile << std::left << std::setw(widths[0]) << std::setprecision(prec)
-               << std::scientific << m_lowBnd + (n + 0.5) * binWidth << " ";
-      condFile << std::left << std::setw(widths[1]) << std::setprecision(prec)
-               << std::scientific << a_condAbs[n] << " ";
-      condFile << std::left << std::setw(widths[2]) << std::setprecision(prec)
-               << std::scientific << a_condVol[n] << " ";
+      for (int c{0}; c < nCond; ++c) {
+        condFile << std::left << std::setw(widths[c]) << std::setprecision(prec)
+                 << std::scientific << binCenter(c, n) << " ";
+      }
+      for (int c{0}; c < nCond; ++c) {
+        condFile << std::left << std::setw(widths[nCond + c])
+                 << std::setprecision(prec) << std::scientific
+                 << a_condAbs[c * m_nBins + n] << " ";
+      }
+      condFile << std::left << std::setw(widths[volCol])
+               << std::setprecision(prec) << std::scientific << a_condVol[n]
+               << " ";
       for (int f{0}; f < nProcessFields; ++f) {
         int binOffset = f * m_nBins;
-        condFile << std::left << std::setw(widths[3 + 2 * f])
+        condFile << std::left << std::setw(widths[volCol + 1 + 2 * f])
                  << std::setprecision(prec) << std::scientific
-                 << a_cond[binOffset + n] << " " << std::setw(widths[4 + 2 * f])
+                 << a_cond[binOffset + n] << " "
+                 << std::setw(widths[volCol + 2 + 2 * f])
                  << std::setprecision(prec) << std::scientific
                  << std::sqrt(std::abs(
                       a_condSq[binOffset + n] -
@@ -383,47 +390,7 @@ DiagConditional::writeIntegralDataToFile(
   const amrex::Vector<amrex::Real>& a_condAbs,
   const amrex::Vector<amrex::Real>& a_cond)
 {
-  std::string diagfile;
-  if (m_interval > 0) {
-    diagfile = amrex::Concatenate(m_diagfile, a_nstep, 6);
-  }
-  if (m_per > 0.0) {
-    diagfile = m_diagfile + std::to_string(a_time);
-  }
-  diagfile = diagfile + ".dat";
-
-  if (amrex::ParallelDescriptor::IOProcessor()) {
-    std::ofstream condFile;
-    condFile.open(diagfile.c_str(), std::ios::out | std::ios::app);
-    const int prec = 8;
-    const int width = 16;
-    const int nProcessFields = static_cast<int>(m_fieldIndices_d.size());
-    amrex::Vector<int> widths(1 + nProcessFields, width);
-
-    widths[0] = std::max(width, static_cast<int>(m_cFieldName.length()) + 1);
-    condFile << std::left << std::setw(widths[0]) << m_cFieldName << " ";
-    for (int f{0}; f < nProcessFields; ++f) {
-      widths[1 + f] =
-        std::max(width, static_cast<int>(m_fieldNames[f].length()) + 5);
-      condFile << std::left << std::setw(widths[1 + f])
-               << m_fieldNames[f] + "_Int" << " ";
-    }
-    condFile << "\n";
-
-    for (int n{0}; n < m_nBins; ++n) {
-      condFile << std::left << std::setw(widths[0]) << std::setprecision(prec)
-               << std::scientific << a_condAbs[n] << " ";
-      for (int f{0}; f < nProcessFields; ++f) {
-        int binOffset = f * m_nBins;
-        condFile << std::left << std::setw(widths[1 + f])
-                 << std::setprecision(prec) << std::scientific
-                 << a_cond[binOffset + n] << " ";
-      }
-      condFile << "\n";
-    }
-    condFile.flush();
-    condFile.close();
-  }
+  writeFieldsDataToFile(a_nstep, a_time, a_condAbs, a_cond, "_Int");
 }
 
 void
@@ -433,39 +400,49 @@ DiagConditional::writeSumDataToFile(
   const amrex::Vector<amrex::Real>& a_condAbs,
   const amrex::Vector<amrex::Real>& a_cond)
 {
-  std::string diagfile;
-  if (m_interval > 0) {
-    diagfile = amrex::Concatenate(m_diagfile, a_nstep, 6);
-  }
-  if (m_per > 0.0) {
-    diagfile = m_diagfile + std::to_string(a_time);
-  }
-  diagfile = diagfile + ".dat";
+  writeFieldsDataToFile(a_nstep, a_time, a_condAbs, a_cond, "_Sum");
+}
+
+void
+DiagConditional::writeFieldsDataToFile(
+  int a_nstep,
+  const amrex::Real& a_time,
+  const amrex::Vector<amrex::Real>& a_condAbs,
+  const amrex::Vector<amrex::Real>& a_cond,
+  const std::string& a_suffix)
+{
+  const std::string diagfile = fileName(a_nstep, a_time);
 
   if (amrex::ParallelDescriptor::IOProcessor()) {
     std::ofstream condFile;
     condFile.open(diagfile.c_str(), std::ios::out | std::ios::app);
     const int prec = 8;
     const int width = 16;
+    const int nCond = static_cast<int>(m_cFieldNames.size());
     const int nProcessFields = static_cast<int>(m_fieldIndices_d.size());
-    amrex::Vector<int> widths(1 + nProcessFields, width);
+    amrex::Vector<int> widths(nCond + nProcessFields, width);
 
-    widths[0] = std::max(width, static_cast<int>(m_cFieldName.length()) + 1);
-    condFile << std::left << std::setw(widths[0]) << m_cFieldName << " ";
+    for (int c{0}; c < nCond; ++c) {
+      widths[c] =
+        std::max(width, static_cast<int>(m_cFieldNames[c].length()) + 1);
+      condFile << std::left << std::setw(widths[c]) << m_cFieldNames[c] << " ";
+    }
     for (int f{0}; f < nProcessFields; ++f) {
-      widths[1 + f] =
+      widths[nCond + f] =
         std::max(width, static_cast<int>(m_fieldNames[f].length()) + 5);
-      condFile << std::left << std::setw(widths[1 + f])
-               << m_fieldNames[f] + "_Sum" << " ";
+      condFile << std::left << std::setw(widths[nCond + f])
+               << m_fieldNames[f] + a_suffix << " ";
     }
     condFile << "\n";
 
     for (int n{0}; n < m_nBins; ++n) {
-      condFile << std::left << std::setw(widths[0]) << std::setprecision(prec)
-               << std::scientific << a_condAbs[n] << " ";
+      for (int c{0}; c < nCond; ++c) {
+        condFile << std::left << std::setw(widths[c]) << std::setprecision(prec)
+                 << std::scientific << a_condAbs[c * m_nBins + n] << " ";
+      }
       for (int f{0}; f < nProcessFields; ++f) {
         int binOffset = f * m_nBins;
-        condFile << std::left << std::setw(widths[1 + f])
+        condFile << std::left << std::setw(widths[nCond + f])
                  << std::setprecision(prec) << std::scientific
                  << a_cond[binOffset + n] << " ";
       }
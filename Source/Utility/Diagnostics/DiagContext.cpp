@@ -0,0 +1,160 @@
+#include "DiagContext.H"
+#include "AMReX_MultiFabUtil.H"
+
+#include <algorithm>
+
+const amrex::iMultiFab&
+DiagContext::fineMask(
+  int a_lev,
+  const amrex::BoxArray& a_grids,
+  const amrex::DistributionMapping& a_dmap,
+  const amrex::BoxArray* a_fineGrids,
+  const amrex::IntVect& a_refRatio)
+{
+  if (a_lev >= m_masks.size()) {
+    m_masks.resize(a_lev + 1);
+  }
+  auto& entry = m_masks[a_lev];
+  const bool hasFine = (a_fineGrids != nullptr);
+  if (
+    entry.mask && entry.key.matches(a_grids, a_dmap) &&
+    (hasFine ? (entry.fineGrids == *a_fineGrids && entry.refRatio == a_refRatio)
+             : entry.fineGrids.empty())) {
+    return *entry.mask;
+  }
+
+  entry.key = LevelKey{a_grids, a_dmap};
+  if (hasFine) {
+    entry.fineGrids = *a_fineGrids;
+    entry.refRatio = a_refRatio;
+    entry.mask = std::make_unique<amrex::iMultiFab>(amrex::makeFineMask(
+      a_grids, a_dmap, amrex::IntVect(0), *a_fineGrids, a_refRatio,
+      amrex::Periodicity::NonPeriodic(), 1, 0));
+  } else {
+    entry.fineGrids = amrex::BoxArray();
+    entry.refRatio = amrex::IntVect(1);
+    entry.mask = std::make_unique<amrex::iMultiFab>(
+      a_grids, a_dmap, 1, amrex::IntVect(0));
+    entry.mask->setVal(1);
+  }
+  return *entry.mask;
+}
+
+const amrex::MultiFab&
+DiagContext::volume(
+  int a_lev,
+  const amrex::Geometry& a_geom,
+  const amrex::BoxArray& a_grids,
+  const amrex::DistributionMapping& a_dmap)
+{
+  if (a_lev >= m_volumes.size()) {
+    m_volumes.resize(a_lev + 1);
+  }
+  auto& entry = m_volumes[a_lev];
+  if (entry.volume && entry.key.matches(a_grids, a_dmap)) {
+    return *entry.volume;
+  }
+
+  entry.key = LevelKey{a_grids, a_dmap};
+  entry.volume = std::make_unique<amrex::MultiFab>(a_grids, a_dmap, 1, 0);
+  a_geom.GetVolume(*entry.volume);
+  return *entry.volume;
+}
+
+const DiagContext::PlaneStencil&
+DiagContext::planeStencil(
+  int a_lev,
+  const amrex::Geometry& a_geom,
+  const amrex::BoxArray& a_grids,
+  const amrex::DistributionMapping& a_dmap,
+  int a_normal,
+  amrex::Real a_center,
+  bool a_quadratic)
+{
+  if (a_lev >= m_planes.size()) {
+    m_planes.resize(a_lev + 1);
+  }
+  auto& entries = m_planes[a_lev];
+  // Stencils of a previous grid layout are stale
+  entries.erase(
+    std::remove_if(
+      entries.begin(), entries.end(),
+      [&](const PlaneEntry& e) { return !e.key.matches(a_grids, a_dmap); }),
+    entries.end());
+  for (const auto& e : entries) {
+    if (
+      e.stencil.normal == a_normal && e.stencil.center == a_center &&
+      e.stencil.quadratic == a_quadratic) {
+      return e.stencil;
+    }
+  }
+
+  PlaneEntry entry;
+  entry.key = LevelKey{a_grids, a_dmap};
+  auto& st = entry.stencil;
+  st.normal = a_normal;
+  st.center = a_center;
+  st.quadratic = a_quadratic;
+
+  // Find the k0 where the plane lays and the weight of the directionnal
+  // interpolation
+  const amrex::Real* dx = a_geom.CellSize();
+  const amrex::Real* problo = a_geom.ProbLo();
+  // How many dx away from the lowest cell-center ?
+  amrex::Real dist =
+    (a_center - (problo[a_normal] + 0.5 * dx[a_normal])) / dx[a_normal];
+  const int k0 = static_cast<int>(std::round(dist));
+  dist -= static_cast<amrex::Real>(k0);
+  st.k0 = k0;
+  if (a_quadratic) {
+    // Quadratic interp. weights on k0-1, k0, k0+1
+    st.intwgt[0] = 0.5 * (dist - 1.0) * (dist - 2.0);
+    st.intwgt[1] = dist * (2.0 - dist);
+    st.intwgt[2] = 0.5 * dist * (dist - 1.0);
+  } else {
+    // linear interp. weights on k0-1, k0, k0+1
+    if (dist > 0.0) {
+      st.intwgt[0] = 0.0;
+      st.intwgt[1] = 1.0 - dist;
+      st.intwgt[2] = dist;
+    } else if (dist < 0.0) {
+      st.intwgt[0] = -dist;
+      st.intwgt[1] = 1.0 + dist;
+      st.intwgt[2] = 0.0;
+    } else {
+      st.intwgt[0] = 0.0;
+      st.intwgt[1] = 1.0;
+      st.intwgt[2] = 0.0;
+    }
+  }
+
+  // Assemble the 2D slice boxArray
+  amrex::Vector<int> pmap;
+  amrex::BoxList bl(a_grids.ixType());
+  bl.reserve(a_grids.size());
+  for (int i = 0; i < a_grids.size(); ++i) {
+    auto cBox = a_grids[i];
+    amrex::IntVect ploc(
+      AMREX_D_DECL(cBox.smallEnd(0), cBox.smallEnd(1), cBox.smallEnd(2)));
+    ploc[a_normal] = k0;
+    if (cBox.contains(ploc)) {
+      amrex::Box zNormalBax;
+      int idx = 0;
+      for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+        if (idim != a_normal) {
+          zNormalBax.setRange(idx, cBox.smallEnd(idim), cBox.length(idim));
+          idx++;
+        }
+      }
+      zNormalBax.setRange(AMREX_SPACEDIM - 1, 0, 1);
+      bl.push_back(zNormalBax);
+      pmap.push_back(a_dmap[i]);
+      st.dmConvert.push_back(i);
+    }
+  }
+  st.sliceBA.define(bl);
+  st.sliceDM.define(pmap);
+
+  entries.push_back(std::move(entry));
+  return entries.back().stencil;
+}
@@ -140,78 +140,23 @@ DiagFramePlane::prepare(
     first_time = false;
   }
 
-  // Resize internal vectors
+  // Interpolation weights and 2D slice boxArrays, shared through the
+  // diagnostics context and only rebuilt when the grids of a level change
+  auto& ctx = context();
   m_intwgt.resize(a_nlevels);
   m_k0.resize(a_nlevels);
-
-  // On each level, find the k0 where the plane lays
-  // and the weight of the directionnal interpolation
-  for (int lev = 0; lev < a_nlevels; lev++) {
-    const amrex::Real* dx = a_geoms[lev].CellSize();
-    const amrex::Real* problo = a_geoms[lev].ProbLo();
-    // How many dx away from the lowest cell-center ?
-    amrex::Real dist =
-      (m_center[m_normal] - (problo[m_normal] + 0.5 * dx[m_normal])) /
-      dx[m_normal];
-    int k0 = static_cast<int>(std::round(dist));
-    dist -= static_cast<amrex::Real>(k0);
-    m_k0[lev] = k0;
-    if (m_interpType == Quadratic) {
-      // Quadratic interp. weights on k0-1, k0, k0+1
-      m_intwgt[lev][0] = 0.5 * (dist - 1.0) * (dist - 2.0);
-      m_intwgt[lev][1] = dist * (2.0 - dist);
-      m_intwgt[lev][2] = 0.5 * dist * (dist - 1.0);
-      ;
-    } else if (m_interpType == Linear) {
-      // linear interp. weights on k0-1, k0, k0+1
-      if (dist > 0.0) {
-        m_intwgt[lev][0] = 0.0;
-        m_intwgt[lev][1] = 1.0 - dist;
-        m_intwgt[lev][2] = dist;
-      } else if (dist < 0.0) {
-        m_intwgt[lev][0] = -dist;
-        m_intwgt[lev][1] = 1.0 + dist;
-        m_intwgt[lev][2] = 0.0;
-      } else {
-        m_intwgt[lev][0] = 0.0;
-        m_intwgt[lev][1] = 1.0;
-        m_intwgt[lev][2] = 0.0;
-      }
-    }
-  }
-
-  // Assemble the 2D slice boxArray
   m_sliceBA.resize(a_nlevels);
   m_sliceDM.resize(a_nlevels);
   m_dmConvert.resize(a_nlevels);
   for (int lev = 0; lev < a_nlevels; lev++) {
-    amrex::Vector<int> pmap;
-    amrex::BoxList bl(a_grids[lev].ixType());
-    bl.reserve(a_grids[lev].size());
-    amrex::Vector<int> dmConvertLev;
-    for (int i = 0; i < a_grids[lev].size(); ++i) {
-      auto cBox = a_grids[lev][i];
-      amrex::IntVect ploc(
-        AMREX_D_DECL(cBox.smallEnd(0), cBox.smallEnd(1), cBox.smallEnd(2)));
-      ploc[m_normal] = m_k0[lev];
-      if (cBox.contains(ploc)) {
-        amrex::Box zNormalBax;
-        int idx = 0;
-        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
-          if (idim != m_normal) {
-            zNormalBax.setRange(idx, cBox.smallEnd(idim), cBox.length(idim));
-            idx++;
-          }
-        }
-        zNormalBax.setRange(AMREX_SPACEDIM - 1, 0, 1);
-        bl.push_back(zNormalBax);
-        pmap.push_back(a_dmap[lev][i]);
-        dmConvertLev.push_back(i);
-      }
-      m_dmConvert[lev] = dmConvertLev;
-    }
-    m_sliceBA[lev].define(bl);
-    m_sliceDM[lev].define(pmap);
+    const auto& stencil = ctx.planeStencil(
+      lev, a_geoms[lev], a_grids[lev], a_dmap[lev], m_normal,
+      m_center[m_normal], m_interpType == Quadratic);
+    m_k0[lev] = stencil.k0;
+    m_intwgt[lev] = stencil.intwgt;
+    m_sliceBA[lev] = stencil.sliceBA;
+    m_sliceDM[lev] = stencil.sliceDM;
+    m_dmConvert[lev] = stencil.dmConvert;
   }
 }
 
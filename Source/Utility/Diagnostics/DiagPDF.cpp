@@ -7,17 +7,40 @@ DiagPDF::init(const std::string& a_prefix, std::string_view a_diagName)
   DiagBase::init(a_prefix, a_diagName);
 
   amrex::ParmParse pp(a_prefix);
-  pp.get("field_name", m_fieldName);
-  pp.get("nBins", m_nBins);
-  AMREX_ASSERT(m_nBins > 0);
+  // A single field, or several fields binned in the same sweep
+  if (pp.countval("field_names") != 0) {
+    pp.getarr("field_names", m_fieldNames);
+  } else {
+    m_fieldNames.resize(1);
+    pp.get("field_name", m_fieldNames[0]);
+  }
+  const int nFields = static_cast<int>(m_fieldNames.size());
+  pp.query("joint", m_joint);
+  if (m_joint && nFields != 2) {
+    amrex::Abort("DiagPDF: joint PDF requires two field_names in " + a_prefix);
+  }
+
+  // Number of bins: the same for all the fields or one per field
+  m_nBins.resize(nFields);
+  const int nBinsCount = pp.countval("nBins");
+  AMREX_ALWAYS_ASSERT(nBinsCount == 1 || nBinsCount == nFields);
+  for (int f{0}; f < nFields; ++f) {
+    pp.get("nBins", m_nBins[f], nBinsCount == 1 ? 0 : f);
+    AMREX_ASSERT(m_nBins[f] > 0);
+  }
   pp.query("normalized", m_normalized);
   pp.query("volume_weighted", m_volWeighted);
 
+  m_lowBnd.resize(nFields, 0.0);
+  m_highBnd.resize(nFields, 0.0);
   if (pp.countval("range") != 0) {
+    AMREX_ALWAYS_ASSERT(pp.countval("range") == 2 * nFields);
     amrex::Vector<amrex::Real> range{0.0};
-    pp.getarr("range", range, 0, 2);
-    m_lowBnd = std::min(range[0], range[1]);
-    m_highBnd = std::max(range[0], range[1]);
+    pp.getarr("range", range, 0, 2 * nFields);
+    for (int f{0}; f < nFields; ++f) {
+      m_lowBnd[f] = std::min(range[2 * f], range[2 * f + 1]);
+      m_highBnd[f] = std::max(range[2 * f], range[2 * f + 1]);
+    }
     m_useFieldMinMax = false;
   }
 }
@@ -26,7 +49,9 @@ void
 DiagPDF::addVars(amrex::Vector<std::string>& a_varList)
 {
   DiagBase::addVars(a_varList);
-  a_varList.push_back(m_fieldName);
+  for (const auto& v : m_fieldNames) {
+    a_varList.push_back(v);
+  }
 }
 
 void
@@ -60,98 +85,120 @@ DiagPDF::processDiag(
   const amrex::Vector<const amrex::MultiFab*>& a_state,
   const amrex::Vector<std::string>& a_stateVar)
 {
-  // Set PDF range
-  int fieldIdx = getFieldIndex(m_fieldName, a_stateVar);
-  if (m_useFieldMinMax) {
-    m_lowBnd = MFVecMin(a_state, fieldIdx);
-    m_highBnd = MFVecMax(a_state, fieldIdx);
+  // Set PDF ranges and binning
+  const int nFields = static_cast<int>(m_fieldNames.size());
+  amrex::Vector<DiagBinData> hostBins(nFields);
+  for (int f{0}; f < nFields; ++f) {
+    hostBins[f].m_varIdx = getFieldIndex(m_fieldNames[f], a_stateVar);
+    if (m_useFieldMinMax) {
+      m_lowBnd[f] = MFVecMin(a_state, hostBins[f].m_varIdx);
+      m_highBnd[f] = MFVecMax(a_state, hostBins[f].m_varIdx);
+    }
+    hostBins[f].m_nBins = m_nBins[f];
+    hostBins[f].m_lowBnd = m_lowBnd[f];
+    hostBins[f].m_binWidth = (m_highBnd[f] - m_lowBnd[f]) / m_nBins[f];
+  }
+  amrex::Gpu::DeviceVector<DiagBinData> bins_d(nFields);
+  amrex::Gpu::copy(
+    amrex::Gpu::hostToDevice, hostBins.begin(), hostBins.end(),
+    bins_d.begin());
+
+  // Either nBins[0] x nBins[1] joint bins, or the bins of each field one
+  // after the other
+  const bool joint = m_joint;
+  const int nGroups = joint ? 1 : nFields;
+  int nHistBins = joint ? m_nBins[0] * m_nBins[1] : 0;
+  if (!joint) {
+    for (int f{0}; f < nFields; ++f) {
+      nHistBins += m_nBins[f];
+    }
   }
-  amrex::Real binWidth = (m_highBnd - m_lowBnd) / m_nBins;
 
   // Data holders
-  amrex::Gpu::DeviceVector<amrex::Real> pdf_d(m_nBins, 0.0);
-  amrex::Vector<amrex::Real> pdf(m_nBins, 0.0);
+  amrex::Gpu::DeviceVector<amrex::Real> pdf_d(nHistBins, 0.0);
+  amrex::Vector<amrex::Real> pdf(nHistBins, 0.0);
 
   // Populate the data from each level on each proc
   for (int lev = 0; lev < a_state.size(); ++lev) {
 
-    // Make mask tagging fine-covered and filtered cells
-    amrex::iMultiFab mask;
-    if (lev == a_state.size() - 1) {
-      mask.define(
-        a_state[lev]->boxArray(), a_state[lev]->DistributionMap(), 1,
-        amrex::IntVect(0));
-      mask.setVal(1);
-    } else {
-      mask = amrex::makeFineMask(
-        *a_state[lev], *a_state[lev + 1], amrex::IntVect(0), m_refRatio[lev],
-        amrex::Periodicity::NonPeriodic(), 1, 0);
-    }
+    // Fine-covered cells mask and volumes are cached by the context,
+    // filters are checked on the fly
+    const auto& ba = a_state[lev]->boxArray();
+    const auto& dm = a_state[lev]->DistributionMap();
+    const bool finest = (lev == a_state.size() - 1);
+    const auto& mask = context().fineMask(
+      lev, ba, dm, finest ? nullptr : &a_state[lev + 1]->boxArray(),
+      finest ? amrex::IntVect(1) : m_refRatio[lev]);
     auto const& sarrs = a_state[lev]->const_arrays();
-    auto const& marrs = mask.arrays();
+    auto const& marrs = mask.const_arrays();
     auto* fdata_p = m_filterData.data();
-    amrex::ParallelFor(
-      *a_state[lev], amrex::IntVect(0),
-      [=, nFilters = m_filters.size()] AMREX_GPU_DEVICE(
-        int box_no, int i, int j, int k) noexcept {
-        for (int f{0}; f < nFilters; ++f) {
-          amrex::Real fval = sarrs[box_no](i, j, k, fdata_p[f].m_filterVarIdx);
-          if (fval < fdata_p[f].m_low_val || fval > fdata_p[f].m_high_val) {
-            marrs[box_no](i, j, k) = 0;
-          }
-        }
-      });
-    amrex::Gpu::streamSynchronize();
+    const int nFilters = static_cast<int>(m_filters.size());
+    auto* bins_p = bins_d.data();
+
+    auto binFunc = [=] AMREX_GPU_HOST_DEVICE(
+                     int box_no, int i, int j, int k, int g) noexcept {
+      if (
+        marrs[box_no](i, j, k) == 0 ||
+        !diagFiltersPass(fdata_p, nFilters, sarrs[box_no], i, j, k)) {
+        return -1;
+      }
+      if (joint) {
+        const int b0 = diagBinIndex(bins_p[0], sarrs[box_no], i, j, k);
+        const int b1 = diagBinIndex(bins_p[1], sarrs[box_no], i, j, k);
+        return (b0 >= 0 && b1 >= 0) ? b0 + bins_p[0].m_nBins * b1 : -1;
+      }
+      const int b = diagBinIndex(bins_p[g], sarrs[box_no], i, j, k);
+      if (b < 0) {
+        return -1;
+      }
+      int offset = 0;
+      for (int h{0}; h < g; ++h) {
+        offset += bins_p[h].m_nBins;
+      }
+      return offset + b;
+    };
 
     if (m_volWeighted != 0) {
       // Get the geometry volume to account for 2D-RZ
-      amrex::MultiFab volume(
-        a_state[lev]->boxArray(), a_state[lev]->DistributionMap(), 1, 0);
-      m_geoms[lev].GetVolume(volume);
+      const auto& volume = context().volume(lev, m_geoms[lev], ba, dm);
       auto const& varrs = volume.const_arrays();
-
-      auto* pdf_d_p = pdf_d.dataPtr();
-      amrex::ParallelFor(
-        *a_state[lev], amrex::IntVect(0),
-        [=, nBins = m_nBins, lowBnd = m_lowBnd] AMREX_GPU_DEVICE(
-          int box_no, int i, int j, int k) noexcept {
-          if (marrs[box_no](i, j, k) != 0) {
-            int cbin = static_cast<int>(std::floor(
-              (sarrs[box_no](i, j, k, fieldIdx) - lowBnd) / binWidth));
-            if (cbin >= 0 && cbin < nBins) {
-              amrex::HostDevice::Atomic::Add(
-                &(pdf_d_p[cbin]), varrs[box_no](i, j, k));
-            }
-          }
+      diagHistogramAccumulate(
+        *a_state[lev], nHistBins, 1, nGroups, pdf_d.data(), binFunc,
+        [=] AMREX_GPU_HOST_DEVICE(
+          int box_no, int i, int j, int k, int /*v*/) noexcept {
+          return varrs[box_no](i, j, k);
         });
     } else {
-      auto* pdf_d_p = pdf_d.dataPtr();
-      amrex::ParallelFor(
-        *a_state[lev], amrex::IntVect(0),
-        [=, nBins = m_nBins, lowBnd = m_lowBnd] AMREX_GPU_DEVICE(
-          int box_no, int i, int j, int k) noexcept {
-          if (marrs[box_no](i, j, k) != 0) {
-            int cbin = static_cast<int>(std::floor(
-              (sarrs[box_no](i, j, k, fieldIdx) - lowBnd) / binWidth));
-            if (cbin >= 0 && cbin < nBins) {
-              amrex::HostDevice::Atomic::Add(
-                &(pdf_d_p[cbin]), amrex::Real(1.0));
-            }
-          }
-        });
+      diagHistogramAccumulate(
+        *a_state[lev], nHistBins, 1, nGroups, pdf_d.data(), binFunc,
+        [=] AMREX_GPU_HOST_DEVICE(
+          int /*box_no*/, int /*i*/, int /*j*/, int /*k*/,
+          int /*v*/) noexcept { return amrex::Real(1.0); });
     }
-    amrex::Gpu::streamSynchronize();
   }
+  amrex::Gpu::streamSynchronize();
 
   amrex::Gpu::copy(
     amrex::Gpu::deviceToHost, pdf_d.begin(), pdf_d.end(), pdf.begin());
   amrex::Gpu::streamSynchronize();
   amrex::ParallelDescriptor::ReduceRealSum(
     pdf.data(), static_cast<int>(pdf.size()));
-  auto sum =
-    std::accumulate(pdf.begin(), pdf.end(), decltype(pdf)::value_type(0));
 
-  writePDFToFile(a_nstep, a_time, pdf, sum);
+  if (joint) {
+    auto sum =
+      std::accumulate(pdf.begin(), pdf.end(), decltype(pdf)::value_type(0));
+    writeJointPDFToFile(a_nstep, a_time, pdf, sum);
+  } else {
+    int offset = 0;
+    for (int f{0}; f < nFields; ++f) {
+      amrex::Vector<amrex::Real> pdfField(
+        pdf.begin() + offset, pdf.begin() + offset + m_nBins[f]);
+      auto sum = std::accumulate(
+        pdfField.begin(), pdfField.end(), decltype(pdf)::value_type(0));
+      writePDFToFile(a_nstep, a_time, f, pdfField, sum);
+      offset += m_nBins[f];
+    }
+  }
 }
 
 amrex::Real
@@ -182,21 +229,32 @@ DiagPDF::MFVecMax(
   return mmax;
 }
 
+std::string
+DiagPDF::fileName(
+  int a_nstep, const amrex::Real& a_time, const std::string& a_suffix) const
+{
+  std::string diagfile;
+  if (m_interval > 0) {
+    diagfile = amrex::Concatenate(m_diagfile + a_suffix, a_nstep, 6);
+  }
+  if (m_per > 0.0) {
+    diagfile = m_diagfile + a_suffix + std::to_string(a_time);
+  }
+  return diagfile + ".dat";
+}
+
 void
 DiagPDF::writePDFToFile(
   int a_nstep,
   const amrex::Real& a_time,
+  int a_field,
   const amrex::Vector<amrex::Real>& a_pdf,
   const amrex::Real& a_sum)
 {
-  std::string diagfile;
-  if (m_interval > 0) {
-    diagfile = amrex::Concatenate(m_diagfile, a_nstep, 6);
-  }
-  if (m_per > 0.0) {
-    diagfile = m_diagfile + std::to_string(a_time);
-  }
-  diagfile = diagfile + ".dat";
+  // Several fields are written to separate files
+  const std::string& fieldName = m_fieldNames[a_field];
+  const std::string diagfile = fileName(
+    a_nstep, a_time, m_fieldNames.size() > 1 ? "_" + fieldName : "");
 
   if (amrex::ParallelDescriptor::IOProcessor()) {
     std::ofstream pdfFile;
@@ -205,17 +263,19 @@ DiagPDF::writePDFToFile(
     const int width = 16;
     amrex::Vector<int> widths(2, width);
 
-    amrex::Real binWidth = (m_highBnd - m_lowBnd) / (m_nBins);
+    amrex::Real binWidth =
+      (m_highBnd[a_field] - m_lowBnd[a_field]) / (m_nBins[a_field]);
 
-    widths[0] = std::max(width, static_cast<int>(m_fieldName.length()) + 1);
-    widths[1] = std::max(width, static_cast<int>(m_fieldName.length()) + 5);
-    pdfFile << std::setw(widths[0]) << m_fieldName << " "
-            << std::setw(widths[1]) << m_fieldName + "_PDF" << "\n";
+    widths[0] = std::max(width, static_cast<int>(fieldName.length()) + 1);
+    widths[1] = std::max(width, static_cast<int>(fieldName.length()) + 5);
+    pdfFile << std::setw(widths[0]) << fieldName << " " << std::setw(widths[1])
+            << fieldName + "_PDF" << "\n";
 
     for (int i{0}; i < a_pdf.size(); ++i) {
       pdfFile << std::setw(widths[0]) << std::setprecision(prec)
               << std::scientific
-              << m_lowBnd + (static_cast<amrex::Real>(i) + 0.5) * binWidth
+              << m_lowBnd[a_field] +
+                   (static_cast<amrex::Real>(i) + 0.5) * binWidth
               << " " << std::setw(widths[1]) << std::setprecision(prec)
               << std::scientific << a_pdf[i] / a_sum / binWidth << "\n";
     }
@@ -224,3 +284,52 @@ DiagPDF::writePDFToFile(
     pdfFile.close();
   }
 }
+
+void
+DiagPDF::writeJointPDFToFile(
+  int a_nstep,
+  const amrex::Real& a_time,
+  const amrex::Vector<amrex::Real>& a_pdf,
+  const amrex::Real& a_sum)
+{
+  const std::string diagfile = fileName(a_nstep, a_time, "");
+
+  if (amrex::ParallelDescriptor::IOProcessor()) {
+    std::ofstream pdfFile;
+    pdfFile.open(diagfile.c_str(), std::ios::out);
+    const int prec = 8;
+    const int width = 16;
+    amrex::Vector<int> widths(3, width);
+
+    const amrex::Real binWidth0 = (m_highBnd[0] - m_lowBnd[0]) / (m_nBins[0]);
+    const amrex::Real binWidth1 = (m_highBnd[1] - m_lowBnd[1]) / (m_nBins[1]);
+    const std::string jointName = m_fieldNames[0] + "_" + m_fieldNames[1];
+
+    widths[0] = std::max(width, static_cast<int>(m_fieldNames[0].length()) + 1);
+    widths[1] = std::max(width, static_cast<int>(m_fieldNames[1].length()) + 1);
+    widths[2] = std::max(width, static_cast<int>(jointName.length()) + 6);
+    pdfFile << std::setw(widths[0]) << m_fieldNames[0] << " "
+            << std::setw(widths[1]) << m_fieldNames[1] << " "
+            << std::setw(widths[2]) << jointName + "_JPDF" << "\n";
+
+    // Bins of the first field vary fastest
+    for (int i1{0}; i1 < m_nBins[1]; ++i1) {
+      const amrex::Real x1 =
+        m_lowBnd[1] + (static_cast<amrex::Real>(i1) + 0.5) * binWidth1;
+      for (int i0{0}; i0 < m_nBins[0]; ++i0) {
+        const amrex::Real x0 =
+          m_lowBnd[0] + (static_cast<amrex::Real>(i0) + 0.5) * binWidth0;
+        pdfFile << std::setw(widths[0]) << std::setprecision(prec)
+                << std::scientific << x0 << " " << std::setw(widths[1])
+                << std::setprecision(prec) << std::scientific << x1 << " "
+                << std::setw(widths[2]) << std::setprecision(prec)
+                << std::scientific
+                << a_pdf[i0 + m_nBins[0] * i1] / a_sum / binWidth0 / binWidth1
+                << "\n";
+      }
+    }
+
+    pdfFile.flush();
+    pdfFile.close();
+  }
+}
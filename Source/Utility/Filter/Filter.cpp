@@ -402,6 +402,70 @@ Filter::set_gaussian_5pt_optimized_approx_weights()
   _weights[4] = _weights[0];
 }
 
+// Filter components [nstart, ncnt) of q into qh on box, one direction at a
+// time, through the scratch FABs tmp0 and tmp1. Each pass covers the region
+// needed by the following ones, and handles all the components in one launch.
+void
+run_filter_separable(
+  const amrex::Box& box,
+  const int nstart,
+  const int ncnt,
+  const int ng,
+  const amrex::Real* w,
+  amrex::Array4<const amrex::Real> const& q,
+  amrex::Array4<amrex::Real> const& qh,
+  amrex::FArrayBox& tmp0,
+  amrex::FArrayBox& tmp1)
+{
+  const int nc = ncnt - nstart;
+#if (AMREX_SPACEDIM == 1)
+  // Filter into tmp0 first, q and qh may be the same data
+  amrex::ignore_unused(tmp1);
+  tmp0.resize(box, nc, amrex::The_Async_Arena());
+  const auto t0 = tmp0.array();
+  amrex::ParallelFor(
+    box, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      run_filter_1d<0>(i, j, k, n + nstart, n, ng, w, q, t0);
+    });
+  amrex::ParallelFor(
+    box, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      qh(i, j, k, n + nstart) = t0(i, j, k, n);
+    });
+#else
+  // x pass, on the box grown in the other directions
+  amrex::Box bx0(box);
+  for (int d = 1; d < AMREX_SPACEDIM; d++) {
+    bx0.grow(d, ng);
+  }
+  tmp0.resize(bx0, nc, amrex::The_Async_Arena());
+  const auto t0 = tmp0.array();
+  amrex::ParallelFor(
+    bx0, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      run_filter_1d<0>(i, j, k, n + nstart, n, ng, w, q, t0);
+    });
+#if (AMREX_SPACEDIM == 2)
+  amrex::ignore_unused(tmp1);
+  amrex::ParallelFor(
+    box, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      run_filter_1d<1>(i, j, k, n, n + nstart, ng, w, t0, qh);
+    });
+#else
+  // y pass, on the box grown in z, then z pass
+  const amrex::Box bx1 = amrex::grow(box, 2, ng);
+  tmp1.resize(bx1, nc, amrex::The_Async_Arena());
+  const auto t1 = tmp1.array();
+  amrex::ParallelFor(
+    bx1, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      run_filter_1d<1>(i, j, k, n, n, ng, w, t0, t1);
+    });
+  amrex::ParallelFor(
+    box, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+      run_filter_1d<2>(i, j, k, n, n + nstart, ng, w, t1, qh);
+    });
+#endif
+#endif
+}
+
 // Run the filtering operation on a MultiFab
 void
 Filter::apply_filter(const amrex::MultiFab& in, amrex::MultiFab& out)
@@ -416,27 +480,96 @@ Filter::apply_filter(
   const int nstart,
   const int ncnt)
 {
+  BL_PROFILE("Filter::apply_filter()");
 
   // Ensure enough grow cells
   AMREX_ASSERT(in.nGrow() >= out.nGrow() + _ngrow);
 
-  const auto& ins = in.const_arrays();
-  const auto& outs = out.arrays();
-  out.setVal(0, nstart, ncnt);
-
   amrex::Gpu::DeviceVector<amrex::Real> weights(_weights.size());
   amrex::Real* w = weights.data();
   amrex::Gpu::copy(
     amrex::Gpu::hostToDevice, _weights.begin(), _weights.end(),
     weights.begin());
   const int captured_ngrow = _ngrow;
-
   const amrex::IntVect ngs(out.nGrow());
-  amrex::ParallelFor(
-    in, ngs, ncnt - nstart,
-    [=] AMREX_GPU_DEVICE(int nbx, int i, int j, int k, int nc) noexcept {
-      run_filter(i, j, k, nc, captured_ngrow, nstart, w, ins[nbx], outs[nbx]);
-    });
+
+  if (_separable) {
+    // Tiles keep the scratch data in cache on CPUs
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    {
+      amrex::FArrayBox tmp0;
+      amrex::FArrayBox tmp1;
+      for (amrex::MFIter mfi(out, amrex::TilingIfNotGPU()); mfi.isValid();
+           ++mfi) {
+        run_filter_separable(
+          mfi.growntilebox(ngs), nstart, ncnt, captured_ngrow, w,
+          in.const_array(mfi), out.array(mfi), tmp0, tmp1);
+      }
+    }
+  } else {
+    const auto& ins = in.const_arrays();
+    const auto& outs = out.arrays();
+    out.setVal(0, nstart, ncnt - nstart);
+    amrex::ParallelFor(
+      in, ngs, ncnt - nstart,
+      [=] AMREX_GPU_DEVICE(int nbx, int i, int j, int k, int nc) noexcept {
+        run_filter(
+          i, j, k, nc, captured_ngrow, nstart, w, ins[nbx], outs[nbx]);
+      });
+  }
+  amrex::Gpu::synchronize();
+}
+
+void
+Filter::apply_filter_inplace(
+  amrex::MultiFab& mf, const int nstart, const int ncnt)
+{
+  BL_PROFILE("Filter::apply_filter_inplace()");
+
+  // Ensure enough grow cells
+  AMREX_ASSERT(mf.nGrow() >= _ngrow);
+
+  amrex::Gpu::DeviceVector<amrex::Real> weights(_weights.size());
+  amrex::Real* w = weights.data();
+  amrex::Gpu::copy(
+    amrex::Gpu::hostToDevice, _weights.begin(), _weights.end(),
+    weights.begin());
+  const int captured_ngrow = _ngrow;
+  const int nc = ncnt - nstart;
+  const amrex::IntVect ngs(mf.nGrow() - _ngrow);
+
+  // No tiling: the filtered values are only written once all the data of
+  // the box has been read
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+  {
+    amrex::FArrayBox tmp0;
+    amrex::FArrayBox tmp1;
+    for (amrex::MFIter mfi(mf); mfi.isValid(); ++mfi) {
+      const amrex::Box bx = amrex::grow(mfi.validbox(), ngs);
+      const auto q = mf.array(mfi);
+      if (_separable) {
+        run_filter_separable(
+          bx, nstart, ncnt, captured_ngrow, w, q, q, tmp0, tmp1);
+      } else {
+        // Filter into scratch data, then copy back
+        amrex::FArrayBox filtered(bx, ncnt, amrex::The_Async_Arena());
+        filtered.setVal<amrex::RunOn::Device>(0.0, bx, nstart, nc);
+        const auto qh = filtered.array();
+        amrex::ParallelFor(
+          bx, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+            run_filter(i, j, k, n, captured_ngrow, nstart, w, q, qh);
+          });
+        amrex::ParallelFor(
+          bx, nc, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) noexcept {
+            q(i, j, k, n + nstart) = qh(i, j, k, n + nstart);
+          });
+      }
+    }
+  }
   amrex::Gpu::synchronize();
 }
 
@@ -473,7 +606,6 @@ Filter::apply_filter(
   const int /*ncomp*/)
 {
   const auto q = in.const_array();
-  out.setVal<amrex::RunOn::Device>(0.0, box, nstart, ncnt);
   auto qh = out.array();
 
   amrex::Gpu::DeviceVector<amrex::Real> weights(_weights.size());
@@ -483,9 +615,19 @@ Filter::apply_filter(
     weights.begin());
 
   const int captured_ngrow = _ngrow;
-  amrex::ParallelFor(
-    box, ncnt - nstart,
-    [=] AMREX_GPU_DEVICE(int i, int j, int k, int nc) noexcept {
-      run_filter(i, j, k, nc, captured_ngrow, nstart, w, q, qh);
-    });
+  if (_separable) {
+    amrex::FArrayBox tmp0;
+    amrex::FArrayBox tmp1;
+    run_filter_separable(
+      box, nstart, ncnt, captured_ngrow, w, q, qh, tmp0, tmp1);
+  } else {
+    out.setVal<amrex::RunOn::Device>(0.0, box, nstart, ncnt - nstart);
+    amrex::ParallelFor(
+      box, ncnt - nstart,
+      [=] AMREX_GPU_DEVICE(int i, int j, int k, int nc) noexcept {
+        run_filter(i, j, k, nc, captured_ngrow, nstart, w, q, qh);
+      });
+  }
+  // The weights must outlive the kernels
+  amrex::Gpu::streamSynchronize();
 }
@@ -2,6 +2,8 @@
 #include <AMReX_Arena.H>
 #include <AMReX_Gpu.H>
 
+#include <cmath>
+
 static std::string
 read_pmf_file(std::ifstream& in)
 {
@@ -28,7 +30,7 @@ void
 InitParm<PMF::PmfData::DataContainer>::read_pmf(
   const std::string& fname,
   const int a_doAverage,
-  const int /*a_verbose*/,
+  const int a_verbose,
   PMF::PmfData::DataContainer& h_pmf_data)
 {
   std::ifstream infile(fname);
@@ -79,6 +81,9 @@ InitParm<PMF::PmfData::DataContainer>::read_pmf(
     line_count++;
   }
   amrex::Print() << line_count << " data lines found in PMF file" << std::endl;
+  if (line_count < 2) {
+    amrex::Abort("PMF file must have at least 2 data lines");
+  }
 
   h_pmf_data.m_nPoint = line_count;
   h_pmf_data.m_nVar = variable_count - 1;
@@ -101,5 +106,56 @@ InitParm<PMF::PmfData::DataContainer>::read_pmf(
       sinput >> h_pmf_data.pmf_Y[j * h_pmf_data.m_nPoint + i];
     }
   }
+
+  // Cumulative integrals, so cell averages only need the integrals at the
+  // two cell faces
+  const int npts = h_pmf_data.m_nPoint;
+  const amrex::Real* xp = h_pmf_data.pmf_X;
+  h_pmf_data.pmf_Yint = (amrex::Real*)amrex::The_Pinned_Arena()->alloc(
+    sizeYvec * sizeof(amrex::Real));
+  for (int j = 0; j < h_pmf_data.m_nVar; j++) {
+    const amrex::Real* yp = h_pmf_data.pmf_Y + j * npts;
+    amrex::Real* yint = h_pmf_data.pmf_Yint + j * npts;
+    yint[0] = 0.0;
+    for (int i = 0; i < npts - 1; i++) {
+      yint[i + 1] = yint[i] + 0.5 * (xp[i + 1] - xp[i]) * (yp[i] + yp[i + 1]);
+    }
+  }
+
+  // Guide table, with buckets about as wide as the smallest interval (up to
+  // 8 buckets per interval) so a lookup only scans a few points
+  amrex::Real dxmin = xp[npts - 1] - xp[0];
+  for (int i = 0; i < npts - 1; i++) {
+    if (xp[i + 1] < xp[i]) {
+      amrex::Abort("PMF file positions must be increasing");
+    }
+    if (xp[i + 1] > xp[i]) {
+      dxmin = amrex::min(dxmin, xp[i + 1] - xp[i]);
+    }
+  }
+  if (!(dxmin > 0.0)) {
+    amrex::Abort("PMF file positions must span a nonzero length");
+  }
+  const amrex::Real length = xp[npts - 1] - xp[0];
+  const int nbucket = static_cast<int>(amrex::min(
+    amrex::Real(8 * (npts - 1)),
+    amrex::max(amrex::Real(npts - 1), std::ceil(length / dxmin))));
+  const amrex::Real h = length / nbucket;
+  h_pmf_data.m_nBucket = nbucket;
+  h_pmf_data.m_bucketDxinv = 1.0 / h;
+  h_pmf_data.pmf_bucket =
+    (int*)amrex::The_Pinned_Arena()->alloc(nbucket * sizeof(int));
+  int idx = 0;
+  for (int b = 0; b < nbucket; b++) {
+    const amrex::Real xb = xp[0] + b * h;
+    while (idx < npts - 2 && xp[idx + 1] <= xb) {
+      idx++;
+    }
+    h_pmf_data.pmf_bucket[b] = idx;
+  }
+  if (a_verbose > 0) {
+    amrex::Print() << "PMF guide table with " << nbucket << " buckets"
+                   << std::endl;
+  }
 }
 } // namespace pele::physics
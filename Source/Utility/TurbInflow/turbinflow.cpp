@@ -1,6 +1,44 @@
 #include <turbinflow.H>
+#include <AMReX_Utility.H>
+
+#include <streambuf>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PELE_TURBINFLOW_MMAP
+#endif
 
 namespace pele::physics::turbinflow {
+
+namespace {
+// Read-only stream over a memory mapped range
+struct MappedBuf : std::streambuf
+{
+  MappedBuf(const char* a_begin, const char* a_end)
+  {
+    char* b = const_cast<char*>(a_begin);
+    setg(b, b, const_cast<char*>(a_end));
+  }
+};
+} // namespace
+
+TurbInflow::~TurbInflow()
+{
+  for (auto& tpn : tp) {
+    // Let the reads in flight complete before releasing the data
+    if (tpn.prefetch.valid()) {
+      tpn.prefetch.wait();
+    }
+#ifdef PELE_TURBINFLOW_MMAP
+    if (tpn.mmap_data != nullptr) {
+      munmap(const_cast<char*>(tpn.mmap_data), tpn.mmap_size);
+    }
+#endif
+  }
+}
 void
 TurbInflow::init(amrex::Geometry const& /*geom*/)
 {
@@ -68,6 +106,8 @@ TurbInflow::init(amrex::Geometry const& /*geom*/)
       AMREX_ASSERT(tp[n].nplane > 0);
       pp.query("turb_conv_vel", tp[n].turb_conv_vel);
       AMREX_ASSERT(tp[n].turb_conv_vel > 0);
+      pp.query("turb_prefetch", tp[n].do_prefetch);
+      pp.query("turb_mmap", tp[n].use_mmap);
 
       // Set other stuff
       std::string turb_header = tp[n].m_turb_file + "/HDR";
@@ -110,7 +150,15 @@ TurbInflow::init(amrex::Geometry const& /*geom*/)
         amrex::IntVect(AMREX_D_DECL(1, 1, 1)),
         amrex::IntVect(AMREX_D_DECL(npts[0], npts[1], tp[n].nplane)));
 
-      tp[n].sdata = new amrex::FArrayBox(sbx, 3, amrex::The_Async_Arena());
+      tp[n].sdata =
+        std::make_unique<amrex::FArrayBox>(sbx, 3, amrex::The_Async_Arena());
+      tp[n].sdata_next =
+        std::make_unique<amrex::FArrayBox>(sbx, 3, amrex::The_Async_Arena());
+#ifdef AMREX_USE_GPU
+      // Planes are read on the host and uploaded asynchronously
+      tp[n].hdata =
+        std::make_unique<amrex::FArrayBox>(sbx, 3, amrex::The_Pinned_Arena());
+#endif
 
       AMREX_D_TERM(, , tp[n].kmax = npts[2];)
 
@@ -129,6 +177,30 @@ TurbInflow::init(amrex::Geometry const& /*geom*/)
         is >> tp[n].offset[i];
       }
       is.close();
+
+      if (tp[n].use_mmap) {
+#ifdef PELE_TURBINFLOW_MMAP
+        // Ranks of a node share the mapped pages of the file
+        std::string turb_data = tp[n].m_turb_file + "/DAT";
+        int fd = open(turb_data.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+          amrex::Abort("Unable to open input file " + turb_data);
+        }
+        tp[n].mmap_size = static_cast<std::size_t>(st.st_size);
+        void* addr =
+          mmap(nullptr, tp[n].mmap_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+          amrex::Abort("Unable to memory map " + turb_data);
+        }
+        tp[n].mmap_data = static_cast<const char*>(addr);
+#else
+        amrex::Print() << "turbinflow.turb_mmap is not supported on this "
+                          "platform and will be ignored \n";
+        tp[n].use_mmap = false;
+#endif
+      }
     }
     turbinflow_initialized = true;
   }
@@ -226,66 +298,165 @@ TurbInflow::set_turb(
   });
 }
 
-void
-TurbInflow::read_one_turb_plane(TurbParm& a_tp, int iplane, int k)
+bool
+TurbInflow::read_turb_chunk(
+  const TurbParm& a_tp, int izlo, amrex::FArrayBox& a_dst)
 {
-  // There are AMREX_SPACEDIM * kmax planes of FABs.
-  // The first component are in the first kmax planes,
-  // the second component in the next kmax planes, ....
-  // Note also that both (*plane) and (*ncomp) start from
-  // 1 not 0 since they're passed from Fortran.
-
-  std::string turb_data = a_tp.m_turb_file + "/DAT";
-  std::ifstream ifs(turb_data.c_str());
-  if (!ifs.is_open()) {
-    amrex::Abort("Unable to open input file " + turb_data);
+  // Read planes izlo to izlo + nplane - 1 into the host accessible a_dst.
+  // This may run on a background thread: failures are reported to the caller
+  std::ifstream ifs;
+  if (!a_tp.use_mmap) {
+    std::string turb_data = a_tp.m_turb_file + "/DAT";
+    ifs.open(turb_data.c_str());
+    if (!ifs.is_open()) {
+      return false;
+    }
   }
 
-  amrex::Box dstBox = a_tp.sdata->box();
-  dstBox.setSmall(AMREX_SPACEDIM - 1, iplane);
-  dstBox.setBig(AMREX_SPACEDIM - 1, iplane);
-
-  for (int n = 0; n < AMREX_SPACEDIM; ++n) {
-
-    const long offset_idx = (k + 1) + (n * a_tp.kmax);
-    AMREX_ASSERT_WITH_MESSAGE(
-      offset_idx < a_tp.offset_size, "Bad turb fab offset idx");
-
-    const long start = a_tp.offset[offset_idx];
+  amrex::FArrayBox tmp(amrex::The_Cpu_Arena());
+  for (int iplane = 1; iplane <= a_tp.nplane; ++iplane) {
+    const int k = (izlo + iplane - 1) % (a_tp.npboxcells[2] - 2);
+    amrex::Box dstBox = a_dst.box();
+    dstBox.setSmall(AMREX_SPACEDIM - 1, iplane);
+    dstBox.setBig(AMREX_SPACEDIM - 1, iplane);
 
-    ifs.seekg(start, std::ios::beg);
+    for (int n = 0; n < AMREX_SPACEDIM; ++n) {
+      const long offset_idx = (k + 1) + (n * a_tp.kmax);
+      if (offset_idx >= a_tp.offset_size) {
+        return false;
+      }
+      const long start = a_tp.offset[offset_idx];
 
-    if (!ifs.good()) {
-      amrex::Abort("getplane(): seekg() failed");
+      if (a_tp.use_mmap) {
+        if (start < 0 || static_cast<std::size_t>(start) >= a_tp.mmap_size) {
+          return false;
+        }
+        MappedBuf buf(a_tp.mmap_data + start, a_tp.mmap_data + a_tp.mmap_size);
+        std::istream is(&buf);
+        tmp.readFrom(is);
+      } else {
+        ifs.seekg(start, std::ios::beg);
+        if (!ifs.good()) {
+          return false;
+        }
+        tmp.readFrom(ifs);
+      }
+      a_dst.copy<amrex::RunOn::Host>(tmp, tmp.box(), 0, dstBox, n, 1);
     }
+  }
+  return true;
+}
 
-    amrex::FArrayBox tmp;
-    tmp.readFrom(ifs);
-    amrex::Box srcBox = tmp.box();
+void
+TurbInflow::start_prefetch(TurbParm& a_tp)
+{
+  // The next chunk is needed once the position passes the last usable point
+  // of the current one, by at most one increment of the position: start it
+  // where the current one ends, or later so that it covers that increment
+  const int izhi_cur = static_cast<int>(std::round(a_tp.szhi * a_tp.dxinv[2]));
+  const amrex::Real zmax = a_tp.szhi - 0.5 * a_tp.dx[2] + a_tp.zstep;
+  a_tp.izlo_next = amrex::max(
+    izhi_cur - 1,
+    static_cast<int>(std::ceil(zmax * a_tp.dxinv[2] + 1.5)) - a_tp.nplane);
+  a_tp.next_ok = false;
+
+  const TurbParm* tpp = &a_tp;
+  amrex::FArrayBox* dst = a_tp.next_host();
+  const int izlo = a_tp.izlo_next;
+  a_tp.prefetch = std::async(std::launch::async, [tpp, dst, izlo]() {
+    const amrex::Real t0 = amrex::second();
+    const bool ok = read_turb_chunk(*tpp, izlo, *dst);
+    return ok ? amrex::Real(amrex::second() - t0) : amrex::Real(-1.0);
+  });
+}
 
-    a_tp.sdata->copy<amrex::RunOn::Device>(tmp, srcBox, 0, dstBox, n, 1);
+void
+TurbInflow::finish_prefetch(TurbParm& a_tp, bool a_wait)
+{
+  if (!a_tp.prefetch.valid()) {
+    return;
+  }
+  if (
+    !a_wait && a_tp.prefetch.wait_for(std::chrono::seconds(0)) !=
+                 std::future_status::ready) {
+    return;
+  }
+  const amrex::Real rtime = a_tp.prefetch.get();
+  a_tp.next_ok = (rtime >= 0.0);
+  if (a_tp.next_ok) {
+    a_tp.io_read_time += rtime;
+#ifdef AMREX_USE_GPU
+    // Upload while the current chunk is still in use
+    amrex::Gpu::htod_memcpy_async(
+      a_tp.sdata_next->dataPtr(), a_tp.hdata->dataPtr(),
+      a_tp.sdata_next->nBytes());
+#endif
   }
-  ifs.close();
 }
 
 void
 TurbInflow::read_turb_planes(TurbParm& a_tp, amrex::Real z)
 {
+  const amrex::Real t0 = amrex::second();
   int izlo = (int)(round(z * a_tp.dxinv[2])) - 1;
+
+  // Use the chunk read ahead of time if it covers z, read it now otherwise
+  finish_prefetch(a_tp, true);
+  const amrex::Real nextlo = (a_tp.izlo_next + 0.5) * a_tp.dx[2];
+  const amrex::Real nexthi = (a_tp.izlo_next + a_tp.nplane - 1.5) * a_tp.dx[2];
+  const bool prefetched = a_tp.next_ok && z >= nextlo && z <= nexthi;
+  if (prefetched) {
+    izlo = a_tp.izlo_next;
+    a_tp.n_prefetched++;
+  } else {
+    const amrex::Real t1 = amrex::second();
+#ifdef AMREX_USE_GPU
+    // The host buffer may still be uploading a mispredicted chunk
+    amrex::Gpu::streamSynchronize();
+#endif
+    if (!read_turb_chunk(a_tp, izlo, *a_tp.next_host())) {
+      amrex::Abort("read_turb_planes(): unable to read " + a_tp.m_turb_file);
+    }
+    a_tp.io_read_time += amrex::second() - t1;
+#ifdef AMREX_USE_GPU
+    amrex::Gpu::htod_memcpy_async(
+      a_tp.sdata_next->dataPtr(), a_tp.hdata->dataPtr(),
+      a_tp.sdata_next->nBytes());
+#endif
+  }
+  std::swap(a_tp.sdata, a_tp.sdata_next);
+  a_tp.n_chunks++;
+
   int izhi = izlo + a_tp.nplane - 1;
   a_tp.szlo = static_cast<amrex::Real>(izlo) * a_tp.dx[2];
   a_tp.szhi = static_cast<amrex::Real>(izhi) * a_tp.dx[2];
+  a_tp.io_wait_time += amrex::second() - t0;
 
   if (a_tp.verbose > 1) {
     amrex::Print() << "read_turb_planes filling " << izlo << " to " << izhi
                    << " covering " << a_tp.szlo + 0.5 * a_tp.dx[2] << " to "
                    << a_tp.szhi - 0.5 * a_tp.dx[2] << " for z = " << z
-                   << std::endl;
+                   << (prefetched ? " (prefetched)" : "") << std::endl;
   }
 
-  for (int iplane = 1; iplane <= a_tp.nplane; ++iplane) {
-    int k = (izlo + iplane - 1) % (a_tp.npboxcells[2] - 2);
-    read_one_turb_plane(a_tp, iplane, k);
+  if (a_tp.do_prefetch) {
+#ifdef AMREX_USE_GPU
+    // The host buffer is reused once its upload is complete
+    amrex::Gpu::streamSynchronize();
+#endif
+    start_prefetch(a_tp);
+  }
+}
+
+void
+TurbInflow::print_io_stats() const
+{
+  for (const auto& tpn : tp) {
+    amrex::Print() << "TurbInflow " << tpn.m_turb_file << ": " << tpn.n_chunks
+                   << " chunks of " << tpn.nplane << " planes ("
+                   << tpn.n_prefetched << " prefetched), " << tpn.io_read_time
+                   << " s reading, " << tpn.io_wait_time
+                   << " s waiting for planes" << std::endl;
   }
 }
 
@@ -297,6 +468,14 @@ TurbInflow::fill_turb_plane(
   amrex::Real z,
   amrex::FArrayBox& v)
 {
+  // Track the position increments to anticipate the next chunk, and upload
+  // it as soon as it has been read
+  if (a_tp.zlast > -1.0e11 && z > a_tp.zlast) {
+    a_tp.zstep = z - a_tp.zlast;
+  }
+  a_tp.zlast = z;
+  finish_prefetch(a_tp, false);
+
   if (
     (z < a_tp.szlo + 0.5 * a_tp.dx[2]) || (z > a_tp.szhi - 0.5 * a_tp.dx[2])) {
     if (a_tp.verbose > 1) {
@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+#
+# Write a synthetic table in the PelePhysics binary table format (see
+# InitParm<TabulatedFunctionData>::read_table in
+# Source/Utility/BlackBoxFunction/Table.H), with smooth analytic data on a
+# grid spanning [0, 1] (log spacing starts at 1e-3) in each dimension.
+# Intended for benchmarking and testing table lookups in more dimensions and
+# with other grid spacings than the sample tables.
+#
+
+# ========================================================================
+#
+# Imports
+#
+# ========================================================================
+import argparse
+import math
+import struct
+
+LEN_STR = 64
+
+
+# ========================================================================
+#
+# Functions
+#
+# ========================================================================
+def pad(name):
+    return name.encode().ljust(LEN_STR, b" ")[:LEN_STR]
+
+
+def value(ivar, x):
+    """Smooth test function of the grid location x for variable ivar."""
+    val = 1.0 + ivar
+    for d, xd in enumerate(x):
+        val += math.sin((ivar + 1) * xd + d) * (0.5 + xd)
+    return val
+
+
+def make_grid(npts, spacing):
+    """Grid points in [0, 1] with the requested spacing."""
+    s = [i / (npts - 1) for i in range(npts)]
+    if spacing == "log":
+        return [1e-3 ** (1.0 - si) for si in s]
+    if spacing == "piecewise":
+        # Fine uniform spacing up to 0.25, coarse uniform spacing beyond
+        nfine = npts // 2
+        fine = [0.25 * i / nfine for i in range(nfine)]
+        ncoarse = npts - nfine
+        return fine + [0.25 + 0.75 * i / (ncoarse - 1) for i in range(ncoarse)]
+    if spacing == "stretched":
+        return [si * si for si in s]
+    return s
+
+
+def write_table(fname, ndim, npts, nvar, spacing):
+    grids = [make_grid(npts, spacing) for _ in range(ndim)]
+    with open(fname, "wb") as f:
+        f.write(struct.pack("i", ndim))
+        for d in range(ndim):
+            f.write(pad(f"dim{d}"))
+        f.write(struct.pack(f"{ndim}i", *([npts] * ndim)))
+        f.write(struct.pack("i", nvar))
+        for g in grids:
+            f.write(struct.pack(f"{npts}d", *g))
+        f.write(b"TEST".ljust(LEN_STR, b"\0"))
+        for ivar in range(nvar):
+            f.write(pad(f"VAR{ivar}"))
+        # Variable-major, first dimension varies fastest
+        ntot = npts**ndim
+        for ivar in range(nvar):
+            data = []
+            for n in range(ntot):
+                x = []
+                for d in range(ndim):
+                    x.append(grids[d][n % npts])
+                    n //= npts
+                data.append(value(ivar, x))
+            f.write(struct.pack(f"{ntot}d", *data))
+
+
+# ========================================================================
+#
+# Main
+#
+# ========================================================================
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Write a synthetic test table")
+    parser.add_argument("-d", "--ndim", type=int, default=3, help="Dimensions")
+    parser.add_argument(
+        "-n", "--npts", type=int, default=16, help="Grid points per dimension"
+    )
+    parser.add_argument("-v", "--nvar", type=int, default=8, help="Variables")
+    parser.add_argument(
+        "-s",
+        "--spacing",
+        default="uniform",
+        choices=["uniform", "log", "piecewise", "stretched"],
+        help="Grid spacing",
+    )
+    parser.add_argument("-o", "--output", help="Output file")
+    args = parser.parse_args()
+
+    fname = args.output or f"testtable_{args.ndim}dim_{args.npts}grid"
+    write_table(fname, args.ndim, args.npts, args.nvar, args.spacing)
+    print(f"Wrote {fname}: {args.ndim}D, {args.npts} points, {args.nvar} vars")
@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+#
+# Generate a header defining a StaticNNModel (see
+# Source/Utility/BlackBoxFunction/NeuralNetStatic.H) with the layer types and
+# sizes of a .pnn neural network file. Build with Manifold_Type=StaticNetwork
+# and the generated StaticNetwork.H in the build directory to evaluate the
+# manifold with the compile-time network. The weights are still read from the
+# .pnn file at runtime, and must match the compiled structure.
+#
+
+# ========================================================================
+#
+# Imports
+#
+# ========================================================================
+import argparse
+import re
+import struct
+
+
+# ========================================================================
+#
+# Functions
+#
+# ========================================================================
+def read_fmt(fmt):
+    """Parse a layer format string like 'f(50,2)f(50)'."""
+    return [
+        (dtype, [int(n) for n in dims.split(",")])
+        for dtype, dims in re.findall(r"([a-z])\(([0-9,]+)\)", fmt)
+    ]
+
+
+def numel(dims):
+    n = 1
+    for d in dims:
+        n *= d
+    return n
+
+
+def read_layers(fname):
+    """Return the input size and a list of (layer name, nin, nout)."""
+    layers = []
+    with open(fname, "rb") as f:
+        ssize, fsize, isize, inpsize = struct.unpack("4i", f.read(16))
+        width = inpsize
+        while True:
+            name = f.read(ssize)
+            if len(name) < ssize:
+                break
+            name = name.rstrip(b"\0").decode()
+            fmt = f.read(ssize).rstrip(b"\0").decode()
+            arrays = read_fmt(fmt)
+            # Same sizes as the NNArrReaders calls in NeuralNetLayerDef.H
+            sizes = [fsize] + [isize] * (len(arrays) - 1)
+            f.seek(sum(numel(a[1]) * s for a, s in zip(arrays, sizes)), 1)
+
+            if name == "Linear":
+                nout, nin = arrays[0][1]
+                if nin != width:
+                    raise ValueError("Linear layer size does not match input")
+                layers.append(("StaticLinearLayer", nin, nout))
+                width = nout
+            elif name == "LeakyReLU":
+                layers.append(("StaticLeakyReluLayer", width, width))
+            elif name == "BatchNorm1d":
+                if arrays[0][1][0] != width:
+                    raise ValueError("BatchNorm1d size does not match input")
+                layers.append(("StaticBatchNorm1dLayer", width, width))
+            else:
+                raise ValueError(f"Unsupported layer type {name}")
+    return inpsize, layers
+
+
+def write_header(fname, layers, alias, source):
+    args = []
+    for name, nin, nout in layers:
+        if name == "StaticLinearLayer":
+            args.append(f"  {name}<{nin}, {nout}>")
+        else:
+            args.append(f"  {name}<{nout}>")
+    with open(fname, "w") as f:
+        f.write(f"// Generated by Support/CMLM/pnn2header.py from {source}\n")
+        f.write("#ifndef STATIC_NETWORK_H\n#define STATIC_NETWORK_H\n\n")
+        f.write('#include "NeuralNetStatic.H"\n\n')
+        f.write("namespace pele::physics {\n\n")
+        f.write(f"using {alias} = StaticNNModel<\n")
+        f.write(",\n".join(args))
+        f.write(">;\n\n")
+        f.write("} // namespace pele::physics\n#endif\n")
+
+
+# ========================================================================
+#
+# Main
+#
+# ========================================================================
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Generate a compile-time network header from a .pnn file"
+    )
+    parser.add_argument("pnn", help="Neural network file (.pnn)")
+    parser.add_argument(
+        "-o", "--output", default="StaticNetwork.H", help="Output header"
+    )
+    parser.add_argument(
+        "-n", "--name", default="StaticNetworkModel", help="Name of the type"
+    )
+    args = parser.parse_args()
+
+    inpsize, layers = read_layers(args.pnn)
+    write_header(args.output, layers, args.name, args.pnn.split("/")[-1])
+    print(f"Wrote {args.output}: {inpsize} inputs, {len(layers)} layers")
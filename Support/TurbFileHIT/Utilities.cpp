@@ -1,5 +1,34 @@
 #include "Utilities.H"
 
+// -----------------------------------------------------------
+// Read consecutive records of a binary file in a single read
+// INPUTS/OUTPUTS:
+// infile => binary input stream
+// ncol   => number of doubles per record
+// first  => index of the first record to read
+// nrec   => number of records to read
+// data   <= output data (nrec * ncol doubles)
+// -----------------------------------------------------------
+void
+read_binary_records(
+  std::ifstream& infile,
+  const size_t ncol,
+  const size_t first,
+  const size_t nrec,
+  double* data)
+{
+  const auto nbytes =
+    static_cast<std::streamsize>(nrec * ncol * sizeof(double));
+  infile.seekg(
+    static_cast<std::streamoff>(first * ncol * sizeof(double)), std::ios::beg);
+  infile.read(reinterpret_cast<char*>(data), nbytes);
+  if (infile.gcount() != nbytes) {
+    amrex::Abort(
+      "Unable to read records " + std::to_string(first) + " to " +
+      std::to_string(first + nrec - 1) + " of the input file");
+  }
+}
+
 // -----------------------------------------------------------
 // Read a binary file
 // INPUTS/OUTPUTS:
@@ -23,9 +52,8 @@ read_binary(
     amrex::Abort("Unable to open input file " + iname);
   }
 
-  for (size_t i = 0; i < nx * ny * nz * ncol; i++) {
-    infile.read(reinterpret_cast<char*>(&data[i]), sizeof(data[i]));
-  }
+  data.resize(nx * ny * nz * ncol);
+  read_binary_records(infile, ncol, 0, nx * ny * nz, data.data());
   infile.close();
 }
 
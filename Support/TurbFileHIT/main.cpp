@@ -1,7 +1,10 @@
 #include <iostream>
+#include <numeric>
+#include <sstream>
 
 #include "AMReX_ParmParse.H"
 #include <AMReX_ParallelDescriptor.H>
+#include <AMReX_MultiFab.H>
 #include <HITData.H>
 #include <main_K.H>
 
@@ -48,9 +51,71 @@ Extend(FArrayBox& xfab, FArrayBox& vfab, const Box& domain)
     Abort("Oops, something bad happened");
 }
 
+// Bytes moved and time spent in each stage, reported at the end
+struct HITIOStats
+{
+  Real read_time = 0.0;
+  Real fill_time = 0.0;
+  Real write_time = 0.0;
+  Long read_bytes = 0;
+  Long write_bytes = 0;
+};
+
+// Output z-planes [a_klo, a_khi] filled by rank a_rank (empty if
+// a_khi < a_klo): the domain is split in slabs of nearly equal thickness
+static void
+outputSlab(const int a_ncell, const int a_rank, int& a_klo, int& a_khi)
+{
+  const Long nprocs = ParallelDescriptor::NProcs();
+  const Long rank = a_rank;
+  a_klo = static_cast<int>(a_ncell * rank / nprocs);
+  a_khi = static_cast<int>(a_ncell * (rank + 1) / nprocs) - 1;
+}
+
+// Gather the velocity slabs of all the ranks on the IO rank and write the
+// whole field to a_file. The IO rank holds the whole field, so this is
+// limited to fields fitting in the memory of one node
+static void
+writeTurbFab(
+  const std::string& a_file, const Box& a_domain, const FArrayBox& a_vel)
+{
+  const int ncell = a_domain.length(AMREX_SPACEDIM - 1);
+  BoxList slabs;
+  Vector<int> ranks;
+  for (int r = 0; r < ParallelDescriptor::NProcs(); ++r) {
+    int klo = 0;
+    int khi = 0;
+    outputSlab(ncell, r, klo, khi);
+    if (khi >= klo) {
+      Box bx(a_domain);
+      bx.setSmall(AMREX_SPACEDIM - 1, klo);
+      bx.setBig(AMREX_SPACEDIM - 1, khi);
+      slabs.push_back(bx);
+      ranks.push_back(r);
+    }
+  }
+  MultiFab slab_mf(
+    BoxArray(slabs), DistributionMapping(ranks), AMREX_SPACEDIM, 0);
+  for (MFIter mfi(slab_mf); mfi.isValid(); ++mfi) {
+    slab_mf[mfi].copy<RunOn::Host>(a_vel, mfi.validbox());
+  }
+  const int ioproc = ParallelDescriptor::IOProcessorNumber();
+  MultiFab full(
+    BoxArray(a_domain), DistributionMapping(Vector<int>{ioproc}),
+    AMREX_SPACEDIM, 0);
+  full.ParallelCopy(slab_mf);
+  if (ParallelDescriptor::IOProcessor()) {
+    std::ofstream fabOut;
+    fabOut.open(a_file.c_str(), std::ios::out | std::ios::trunc);
+    full[0].writeOn(fabOut);
+  }
+}
+
 void
-readHIT(HITData* a_data)
+readHIT(HITData* a_data, HITIOStats& a_stats)
 {
+  const Real strt_time = ParallelDescriptor::second();
+
   ParmParse pp;
   std::string hit_file("IC");
   pp.query("hit_file", hit_file);
@@ -74,44 +139,43 @@ readHIT(HITData* a_data)
     << lambda0 << "," << a_data->urms0 << "," << tau << std::endl;
   ofs.close();
 
-  // Read initial velocity field
+  // Records of the input file: x, y, z, u, v, w with x varying fastest, so
+  // that each z-plane is a contiguous block of nx * ny records. Binary files
+  // are read plane by plane with bulk reads, only for the planes of this
+  // rank's slab. ASCII files can't be accessed directly and are read whole.
   const size_t nx = a_data->input_ncell;
   const size_t ny = a_data->input_ncell;
   const size_t nz = a_data->input_ncell;
-  amrex::Vector<amrex::Real> data(
-    nx * ny * nz * 6); /* this needs to be double */
+  const size_t ncol = 6;
+  const size_t nplane = nx * ny;
+  std::ifstream infile;
+  amrex::Vector<amrex::Real> data; /* this needs to be double */
   if (binfmt) {
-    read_binary(hit_file, nx, ny, nz, 6, data);
+    infile.open(hit_file, std::ios::in | std::ios::binary);
+    if (not infile.is_open()) {
+      amrex::Abort("Unable to open input file " + hit_file);
+    }
   } else {
+    data.resize(nx * ny * nz * ncol);
     read_csv(hit_file, nx, ny, nz, data);
-  }
-
-  // Extract position and velocities
-  amrex::Vector<amrex::Real> xinput;
-  amrex::Vector<amrex::Real> uinput;
-  amrex::Vector<amrex::Real> vinput;
-  amrex::Vector<amrex::Real> winput;
-  amrex::Vector<amrex::Real> xdiff;
-  amrex::Vector<amrex::Real> xarray;
-
-  xinput.resize(nx * ny * nz);
-  uinput.resize(nx * ny * nz);
-  vinput.resize(nx * ny * nz);
-  winput.resize(nx * ny * nz);
-
-  for (long i = 0; i < xinput.size(); i++) {
-    xinput[i] = data[0 + i * 6];
-    uinput[i] = data[3 + i * 6] * a_data->urms0 / a_data->uin_norm;
-    vinput[i] = data[4 + i * 6] * a_data->urms0 / a_data->uin_norm;
-    winput[i] = data[5 + i * 6] * a_data->urms0 / a_data->uin_norm;
+    a_stats.read_bytes += static_cast<Long>(data.size() * sizeof(double));
   }
 
   // Get the xarray table and the differences.
-  xarray.resize(nx);
-  for (long i = 0; i < xarray.size(); i++) {
-    xarray[i] = xinput[i];
+  amrex::Vector<amrex::Real> xarray(nx);
+  amrex::Vector<amrex::Real> xdiff(nx);
+  {
+    amrex::Vector<double> xrec(nx * ncol);
+    if (binfmt) {
+      read_binary_records(infile, ncol, 0, nx, xrec.data());
+      a_stats.read_bytes += static_cast<Long>(xrec.size() * sizeof(double));
+    } else {
+      std::copy(data.begin(), data.begin() + nx * ncol, xrec.begin());
+    }
+    for (long i = 0; i < xarray.size(); i++) {
+      xarray[i] = xrec[0 + i * ncol];
+    }
   }
-  xdiff.resize(nx);
   std::adjacent_difference(xarray.begin(), xarray.end(), xdiff.begin());
   xdiff[0] = xdiff[1];
 
@@ -123,26 +187,66 @@ readHIT(HITData* a_data)
   // Pass data to the prob_parm
   a_data->Linput = xarray[nx - 1] + 0.5 * xdiff[nx - 1];
 
+  // Input planes needed to interpolate the output planes of this rank,
+  // using the cell centers of the output geometry built in main
+  outputSlab(
+    a_data->input_ncell, ParallelDescriptor::MyProc(), a_data->slab_klo,
+    a_data->slab_khi);
+  if (a_data->slab_khi >= a_data->slab_klo) {
+    const amrex::Real dz = (xarray[nx - 1] - xarray[0]) / nz;
+    int kmin = static_cast<int>(nz);
+    int kmax = -1;
+    for (int k = a_data->slab_klo; k <= a_data->slab_khi; ++k) {
+      const amrex::Real z = std::fmod(
+        xarray[0] + static_cast<amrex::Real>(k + 0.5) * dz, a_data->Linput);
+      int idx = 0;
+      locate(xarray.data(), static_cast<int>(nz), z, idx);
+      kmin = amrex::min(kmin, idx);
+      kmax = amrex::max(kmax, idx);
+    }
+    a_data->input_klo = kmin;
+    a_data->input_nk = amrex::min(kmax - kmin + 2, static_cast<int>(nz));
+  }
+  const size_t nk = a_data->input_nk;
+
   a_data->d_xarray =
     (amrex::Real*)amrex::The_Arena()->alloc(nx * sizeof(amrex::Real));
   a_data->d_xdiff =
     (amrex::Real*)amrex::The_Arena()->alloc(nx * sizeof(amrex::Real));
-  a_data->d_uinput =
-    (amrex::Real*)amrex::The_Arena()->alloc(nx * ny * nz * sizeof(amrex::Real));
-  a_data->d_vinput =
-    (amrex::Real*)amrex::The_Arena()->alloc(nx * ny * nz * sizeof(amrex::Real));
-  a_data->d_winput =
-    (amrex::Real*)amrex::The_Arena()->alloc(nx * ny * nz * sizeof(amrex::Real));
+  a_data->d_uinput = (amrex::Real*)amrex::The_Arena()->alloc(
+    nplane * amrex::max<size_t>(nk, 1) * sizeof(amrex::Real));
+  a_data->d_vinput = (amrex::Real*)amrex::The_Arena()->alloc(
+    nplane * amrex::max<size_t>(nk, 1) * sizeof(amrex::Real));
+  a_data->d_winput = (amrex::Real*)amrex::The_Arena()->alloc(
+    nplane * amrex::max<size_t>(nk, 1) * sizeof(amrex::Real));
 
   for (int i = 0; i < nx; i++) {
     a_data->d_xarray[i] = xarray[i];
     a_data->d_xdiff[i] = xdiff[i];
   }
-  for (int i = 0; i < nx * ny * nz; i++) {
-    a_data->d_uinput[i] = uinput[i];
-    a_data->d_vinput[i] = vinput[i];
-    a_data->d_winput[i] = winput[i];
+
+  // Extract the velocities of the slab, one input plane at a time
+  const amrex::Real scale = a_data->urms0 / a_data->uin_norm;
+  amrex::Vector<double> plane(binfmt ? nplane * ncol : 0);
+  for (size_t kl = 0; kl < nk; ++kl) {
+    const size_t kg = (a_data->input_klo + kl) % nz;
+    const double* pdata = nullptr;
+    if (binfmt) {
+      read_binary_records(infile, ncol, kg * nplane, nplane, plane.data());
+      a_stats.read_bytes += static_cast<Long>(plane.size() * sizeof(double));
+      pdata = plane.data();
+    } else {
+      pdata = data.data() + kg * nplane * ncol;
+    }
+    for (size_t n = 0; n < nplane; ++n) {
+      const size_t il = n + kl * nplane;
+      a_data->d_uinput[il] = pdata[3 + n * ncol] * scale;
+      a_data->d_vinput[il] = pdata[4 + n * ncol] * scale;
+      a_data->d_winput[il] = pdata[5 + n * ncol] * scale;
+    }
   }
+
+  a_stats.read_time = ParallelDescriptor::second() - strt_time;
 }
 
 int
@@ -153,8 +257,9 @@ main(int argc, char* argv[])
     ParmParse pp;
 
     HITData data;
+    HITIOStats stats;
 
-    readHIT(&data);
+    readHIT(&data, stats);
 
     int ncell = data.input_ncell;
     Real xlo = data.d_xarray[0];
@@ -170,88 +275,189 @@ main(int argc, char* argv[])
     Geometry geom_turb(box_turb, rb_turb, coord_turb, per_turb);
     const Real* dx_turb = geom_turb.CellSize();
 
-    // Fill the velocity FAB with HIT
-    FArrayBox vel_turb(box_turb, AMREX_SPACEDIM);
-    Array4<Real> const& fab = vel_turb.array();
-    auto geomdata = geom_turb.data();
-    AMREX_PARALLEL_FOR_3D(
-      box_turb, i, j, k, { fillVelFab(i, j, k, fab, geomdata, data); });
+    // Fill the velocity FAB of this rank's slab with HIT
+    Real strt_time = ParallelDescriptor::second();
+    int dir = AMREX_SPACEDIM - 1;
+    const bool has_slab = data.slab_khi >= data.slab_klo;
+    Box box_slab(box_turb);
+    box_slab.setSmall(dir, data.slab_klo);
+    box_slab.setBig(dir, amrex::max(data.slab_khi, data.slab_klo));
+    FArrayBox vel_turb;
+    if (has_slab) {
+      vel_turb.resize(box_slab, AMREX_SPACEDIM);
+      Array4<Real> const& fab = vel_turb.array();
+      auto geomdata = geom_turb.data();
+      AMREX_PARALLEL_FOR_3D(
+        box_slab, i, j, k, { fillVelFab(i, j, k, fab, geomdata, data); });
+      Gpu::streamSynchronize();
+    }
+    stats.fill_time = ParallelDescriptor::second() - strt_time;
+
+    // Whole velocity field, for inspection
+    int write_fab = 1;
+    pp.query("write_fab", write_fab);
+    if (write_fab != 0) {
+      writeTurbFab("Turb_D", box_turb, vel_turb);
+    }
 
-    std::ofstream fabOut;
-    fabOut.open("Turb_D", std::ios::out | std::ios::trunc);
-    vel_turb.writeOn(fabOut);
     // Write turbulence file for TurbInflow
+    strt_time = ParallelDescriptor::second();
     std::string TurbDir("Turb");
     pp.query("TurbFile", TurbDir);
 
-    if (ParallelDescriptor::IOProcessor())
-      if (!UtilCreateDirectory(TurbDir, 0755))
-        CreateDirectoryFailed(TurbDir);
-
     std::string Hdr = TurbDir;
     Hdr += "/HDR";
     std::string Dat = TurbDir;
     Dat += "/DAT";
 
-    std::ofstream ifsd, ifsh;
-
-    ifsh.open(Hdr.c_str(), std::ios::out | std::ios::trunc);
-    if (!ifsh.good())
-      FileOpenFailed(Hdr);
+    if (ParallelDescriptor::IOProcessor()) {
+      if (!UtilCreateDirectory(TurbDir, 0755)) {
+        CreateDirectoryFailed(TurbDir);
+      }
+      std::ofstream ifsd(Dat.c_str(), std::ios::out | std::ios::trunc);
+      if (!ifsd.good()) {
+        FileOpenFailed(Dat);
+      }
+    }
+    ParallelDescriptor::Barrier();
 
-    ifsd.open(Dat.c_str(), std::ios::out | std::ios::trunc);
-    if (!ifsd.good())
-      FileOpenFailed(Dat);
+    std::fstream ifsd;
+    if (has_slab) {
+      ifsd.open(Dat.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+      if (!ifsd.good()) {
+        FileOpenFailed(Dat);
+      }
+    }
 
     //
-    // Write the first part of the Turb header.
-    // Note that this is solely for periodic style inflow files.
+    // Dump field as a "turbulence file"
     //
-    Box box_turb_io(box_turb);
-    box_turb_io.setBig(0, box_turb.bigEnd(0) + 3);
-    box_turb_io.setBig(1, box_turb.bigEnd(1) + 3);
-    box_turb_io.setBig(2, box_turb.bigEnd(2) + 1);
-
-    ifsh << box_turb_io.length(0) << ' ' << box_turb_io.length(1) << ' '
-         << box_turb_io.length(2) << '\n';
+    // We work on one cell wide Z-planes. For each component, we first do
+    // the lo plane, and then all the other planes in xhi -> xlo order.
+    // Each rank serializes the planes of its slab and writes them at their
+    // offset in the file, known once the sizes of the planes of all the
+    // ranks are gathered: the lo plane first, then the slabs from the last
+    // rank to the first. The header offsets are reduced to the IO rank.
+    //
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int rank = ParallelDescriptor::MyProc();
+    const int nhdr = AMREX_SPACEDIM * (ncell + 1);
+    Vector<Long> hdr_offset(nhdr, 0);
+    Long dat_size = 0;
+    FArrayBox xfab, TMP;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+      std::stringstream lo_plane;
+      std::stringstream slab_planes;
+      Vector<Long> plane_pos(has_slab ? box_slab.length(dir) : 0, 0);
+      if (has_slab) {
+        IntVect sm = box_slab.smallEnd();
+        IntVect bg = box_slab.bigEnd();
+        if (box_slab.smallEnd(dir) == box_turb.smallEnd(dir)) {
+          bg[dir] = sm[dir];
+          Box bx(sm, bg);
+          TMP.resize(bx, 1);
+          TMP.copy(vel_turb, bx, d, bx, 0, 1);
+          Extend(xfab, TMP, box_turb);
+          xfab.writeOn(lo_plane);
+        }
+        for (int i = box_slab.bigEnd(dir); i >= box_slab.smallEnd(dir); i--) {
+          sm[dir] = i;
+          bg[dir] = i;
+          Box bx(sm, bg);
+          TMP.resize(bx, 1);
+          TMP.copy(vel_turb, bx, d, bx, 0, 1);
+          Extend(xfab, TMP, box_turb);
+          plane_pos[i - box_slab.smallEnd(dir)] = slab_planes.tellp();
+          xfab.writeOn(slab_planes);
+        }
+      }
 
-    ifsh << rb_turb.length(0) + 2 * dx_turb[0] << ' '
-         << rb_turb.length(1) + 2 * dx_turb[1] << ' ' << rb_turb.length(2)
-         << '\n';
+      // Size of the lo plane and of the slab of each rank
+      Vector<Long> seg_size(2 * nprocs, 0);
+      seg_size[2 * rank] = lo_plane.tellp();
+      seg_size[2 * rank + 1] = slab_planes.tellp();
+      ParallelDescriptor::ReduceLongSum(seg_size.data(), 2 * nprocs);
+
+      const Long lo_offset = dat_size;
+      Long slab_offset = dat_size;
+      for (int r = 0; r < nprocs; ++r) {
+        slab_offset += seg_size[2 * r];
+        dat_size += seg_size[2 * r] + seg_size[2 * r + 1];
+      }
+      for (int r = nprocs - 1; r > rank; --r) {
+        slab_offset += seg_size[2 * r + 1];
+      }
 
-    ifsh << per_turb[0] << ' ' << per_turb[1] << ' ' << per_turb[2] << '\n';
+      if (seg_size[2 * rank] > 0) {
+        hdr_offset[d * (ncell + 1)] = lo_offset;
+        ifsd.seekp(lo_offset);
+        ifsd << lo_plane.rdbuf();
+      }
+      if (seg_size[2 * rank + 1] > 0) {
+        for (int i = box_slab.smallEnd(dir); i <= box_slab.bigEnd(dir); i++) {
+          hdr_offset[d * (ncell + 1) + ncell - i] =
+            slab_offset + plane_pos[i - box_slab.smallEnd(dir)];
+        }
+        ifsd.seekp(slab_offset);
+        ifsd << slab_planes.rdbuf();
+      }
+      stats.write_bytes += seg_size[2 * rank] + seg_size[2 * rank + 1];
+    }
+    if (has_slab) {
+      ifsd.close();
+      if (ifsd.fail()) {
+        amrex::Abort("Unable to write " + Dat);
+      }
+    }
+    ParallelDescriptor::ReduceLongSum(
+      hdr_offset.data(), nhdr, ParallelDescriptor::IOProcessorNumber());
 
-    // Dump field as a "turbulence file"
-    IntVect sm = box_turb.smallEnd();
-    IntVect bg = box_turb.bigEnd();
-    int dir = AMREX_SPACEDIM - 1;
-    FArrayBox xfab, TMP;
     //
-    // We work on one cell wide Z-planes.
-    // We first do the lo AMREX_SPACEDIM plane.
-    // And then all the other planes in xhi -> xlo order.
+    // Write the Turb header.
+    // Note that this is solely for periodic style inflow files.
     //
-    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
-      bg[dir] = sm[dir];
-      {
-        Box bx(sm, bg);
-        TMP.resize(bx, 1);
-        TMP.copy(vel_turb, bx, d, bx, 0, 1);
-        Extend(xfab, TMP, box_turb);
-        ifsh << ifsd.tellp() << std::endl;
-        xfab.writeOn(ifsd);
+    if (ParallelDescriptor::IOProcessor()) {
+      std::ofstream ifsh(Hdr.c_str(), std::ios::out | std::ios::trunc);
+      if (!ifsh.good()) {
+        FileOpenFailed(Hdr);
       }
-      for (int i = box_turb.bigEnd(dir); i >= box_turb.smallEnd(dir); i--) {
-        sm[dir] = i;
-        bg[dir] = i;
-        Box bx(sm, bg);
-        TMP.resize(bx, 1);
-        TMP.copy(vel_turb, bx, d, bx, 0, 1);
-        Extend(xfab, TMP, box_turb);
-        ifsh << ifsd.tellp() << std::endl;
-        xfab.writeOn(ifsd);
+
+      Box box_turb_io(box_turb);
+      box_turb_io.setBig(0, box_turb.bigEnd(0) + 3);
+      box_turb_io.setBig(1, box_turb.bigEnd(1) + 3);
+      box_turb_io.setBig(2, box_turb.bigEnd(2) + 1);
+
+      ifsh << box_turb_io.length(0) << ' ' << box_turb_io.length(1) << ' '
+           << box_turb_io.length(2) << '\n';
+
+      ifsh << rb_turb.length(0) + 2 * dx_turb[0] << ' '
+           << rb_turb.length(1) + 2 * dx_turb[1] << ' ' << rb_turb.length(2)
+           << '\n';
+
+      ifsh << per_turb[0] << ' ' << per_turb[1] << ' ' << per_turb[2] << '\n';
+
+      for (int n = 0; n < nhdr; ++n) {
+        ifsh << hdr_offset[n] << '\n';
       }
     }
+    ParallelDescriptor::Barrier();
+    stats.write_time = ParallelDescriptor::second() - strt_time;
+
+    // I/O report: slowest rank and aggregated volume
+    Real times[3] = {stats.read_time, stats.fill_time, stats.write_time};
+    Long bytes[2] = {stats.read_bytes, stats.write_bytes};
+    ParallelDescriptor::ReduceRealMax(
+      times, 3, ParallelDescriptor::IOProcessorNumber());
+    ParallelDescriptor::ReduceLongSum(
+      bytes, 2, ParallelDescriptor::IOProcessorNumber());
+    const Real MB = 1024.0 * 1024.0;
+    Print() << "TurbFileHIT on " << nprocs << " ranks:\n";
+    Print() << "  read  " << bytes[0] / MB << " MB in " << times[0] << " s ("
+            << bytes[0] / MB / amrex::max(times[0], 1.0e-12) << " MB/s)\n";
+    Print() << "  fill  " << times[1] << " s\n";
+    Print() << "  write " << bytes[1] / MB << " MB in " << times[2] << " s ("
+            << bytes[1] / MB / amrex::max(times[2], 1.0e-12) << " MB/s)\n";
+
     amrex::The_Arena()->free(data.d_xarray);
     amrex::The_Arena()->free(data.d_xdiff);
     amrex::The_Arena()->free(data.d_uinput);
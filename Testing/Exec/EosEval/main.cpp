@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -10,6 +11,102 @@
 #include <GPU_misc.H>
 
 #include <PelePhysics.H>
+#ifdef USE_MANIFOLD_EOS
+#include <BlackBoxFunctionBatch.H>
+#endif
+
+#ifdef USE_MANIFOLD_EOS
+// Sum over the variables of a real precision, variable-major table of the
+// largest magnitude of each variable: the scale of the sums of all variables
+// compared by the table lookup benchmark
+amrex::Real
+table_value_scale(const pele::physics::TabulatedFunctionData& tdata)
+{
+  int npts = 1;
+  for (int d = 0; d < tdata.Ndim; ++d) {
+    npts *= tdata.dimLengths[d];
+  }
+  amrex::Real scale = 0.0;
+  for (int iv = 0; iv < tdata.Nvar; ++iv) {
+    const amrex::Real* vals = &tdata.values[iv * tdata.varSpacing];
+    amrex::Real vmax = 0.0;
+    for (int n = 0; n < npts; ++n) {
+      vmax = amrex::max(vmax, std::abs(vals[n]));
+    }
+    scale += vmax;
+  }
+  return scale;
+}
+
+// Bound on the difference between the cubic Hermite and the multilinear
+// interpolation (see interpolate_hermite) of the sum of all variables of a
+// variable-major table. In a cell, the value terms of the Hermite
+// interpolant differ from the multilinear interpolant by at most sqrt(3)/18
+// times the largest jump between neighbouring nodes along each dimension,
+// and the derivatives for a set of dimensions s add at most the product of
+// h_d / 4 over s times their largest magnitude at the corners
+amrex::Real
+table_hermite_bound(const pele::physics::TabulatedFunctionData& tdata)
+{
+  const int ndim = tdata.Ndim;
+  const int nsets = (1 << ndim) - 1;
+  int npts = 1;
+  for (int d = 0; d < ndim; ++d) {
+    npts *= tdata.dimLengths[d];
+  }
+  // Widest cell next to each node along each dimension
+  amrex::Vector<amrex::Vector<amrex::Real>> hmax(ndim);
+  int start = 0;
+  for (int d = 0; d < ndim; ++d) {
+    const int n = tdata.dimLengths[d];
+    const amrex::Real* g = &tdata.grids[start];
+    hmax[d].resize(n);
+    for (int i = 0; i < n; ++i) {
+      const amrex::Real hl = (i > 0) ? g[i] - g[i - 1] : 0.0;
+      const amrex::Real hr = (i < n - 1) ? g[i + 1] - g[i] : 0.0;
+      hmax[d][i] = amrex::max(hl, hr);
+    }
+    start += n;
+  }
+  amrex::Real bound = 0.0;
+  amrex::Vector<amrex::Real> jump(ndim);
+  amrex::Vector<amrex::Real> slope(nsets);
+  for (int iv = 0; iv < tdata.Nvar; ++iv) {
+    const amrex::Real* vals = &tdata.values[iv * tdata.varSpacing];
+    const amrex::Real* derivs = &tdata.hermite[iv * tdata.varSpacing];
+    std::fill(jump.begin(), jump.end(), 0.0);
+    std::fill(slope.begin(), slope.end(), 0.0);
+    for (int n = 0; n < npts; ++n) {
+      int idx[MAXD_TABLE];
+      int rem = n;
+      for (int d = 0; d < ndim; ++d) {
+        idx[d] = rem % tdata.dimLengths[d];
+        rem /= tdata.dimLengths[d];
+        if (idx[d] < tdata.dimLengths[d] - 1) {
+          jump[d] = amrex::max(
+            jump[d], std::abs(vals[n + tdata.dimDataSpacing[d]] - vals[n]));
+        }
+      }
+      for (int set = 1; set <= nsets; ++set) {
+        amrex::Real w = std::abs(derivs[(set - 1) * tdata.hermiteSpacing + n]);
+        for (int d = 0; d < ndim; ++d) {
+          if (((set >> d) & 1) != 0) {
+            w *= 0.25 * hmax[d][idx[d]];
+          }
+        }
+        slope[set - 1] = amrex::max(slope[set - 1], w);
+      }
+    }
+    for (int d = 0; d < ndim; ++d) {
+      bound += std::sqrt(3.0) / 18.0 * jump[d];
+    }
+    for (int set = 0; set < nsets; ++set) {
+      bound += slope[set];
+    }
+  }
+  return bound;
+}
+#endif
 
 int
 main(int argc, char* argv[])
@@ -159,6 +256,338 @@ main(int argc, char* argv[])
           });
       }
     }
+#ifdef USE_MANIFOLD_EOS
+    int do_batch_bench = 0;
+    pp.query("do_batch_bench", do_batch_bench);
+    if (do_batch_bench != 0) {
+      // Compare the per-cell manifold lookups (one call for T, one for Wdot)
+      // with a single batched evaluation of all outputs per box
+      // (Manifold::Y2TWDOT_box)
+      int nbench = 10;
+      pp.query("nbench", nbench);
+      const amrex::Real npts_tot =
+        static_cast<amrex::Real>(domain.numPts()) * nbench;
+      const auto& h_eosparm = eos_parms.host_parm();
+
+      amrex::MultiFab T_cell(ba, dm, 1, num_grow);
+      amrex::MultiFab wdot_cell(ba, dm, NUM_SPECIES, num_grow);
+      amrex::Gpu::synchronize();
+      amrex::Real t0 = amrex::second();
+      for (int ib = 0; ib < nbench; ++ib) {
+        BL_PROFILE("Pele::manifold_per_cell()");
+        for (amrex::MFIter mfi(mass_frac, amrex::TilingIfNotGPU());
+             mfi.isValid(); ++mfi) {
+          const amrex::Box& box = mfi.tilebox();
+          auto const& Y_a = mass_frac.const_array(mfi);
+          auto const& e_a = energy.const_array(mfi);
+          auto const& rho_a = density.array(mfi);
+          auto const& T_a = T_cell.array(mfi);
+          auto const& wdot_a = wdot_cell.array(mfi);
+          amrex::ParallelFor(
+            box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+              get_T_from_EY(i, j, k, Y_a, T_a, rho_a, e_a, leosparm);
+              get_wdot(i, j, k, Y_a, T_a, rho_a, wdot_a, leosparm);
+            });
+        }
+      }
+      amrex::Gpu::synchronize();
+      amrex::Real t_cell = amrex::second() - t0;
+
+      const auto& manfunc_batch = *eos_parms.host_only_parm().manfunc_batch;
+      amrex::MultiFab T_batch(ba, dm, 1, num_grow);
+      amrex::MultiFab wdot_batch(ba, dm, NUM_SPECIES, num_grow);
+      amrex::Gpu::synchronize();
+      t0 = amrex::second();
+      for (int ib = 0; ib < nbench; ++ib) {
+        BL_PROFILE("Pele::manifold_batched()");
+        for (amrex::MFIter mfi(mass_frac, amrex::TilingIfNotGPU());
+             mfi.isValid(); ++mfi) {
+          pele::physics::eos::Manifold::Y2TWDOT_box(
+            mfi.tilebox(), mass_frac.const_array(mfi), T_batch.array(mfi),
+            wdot_batch.array(mfi), h_eosparm, manfunc_batch);
+        }
+      }
+      amrex::Gpu::synchronize();
+      amrex::Real t_batch = amrex::second() - t0;
+
+      // Batched outputs must match the per-cell path up to the roundoff of
+      // the fused network layers, relative to the magnitude of each output
+      amrex::Real batch_tol = 1.e-10;
+      pp.query("batch_tol", batch_tol);
+      amrex::MultiFab::Subtract(T_batch, T_cell, 0, 0, 1, 0);
+      amrex::MultiFab::Subtract(wdot_batch, wdot_cell, 0, 0, NUM_SPECIES, 0);
+      amrex::Real maxdiff =
+        T_batch.norm0(0) / amrex::max(T_cell.norm0(0), 1.e-300);
+      for (int n = 0; n < NUM_SPECIES; ++n) {
+        maxdiff = amrex::max(
+          maxdiff,
+          wdot_batch.norm0(n) / amrex::max(wdot_cell.norm0(n), 1.e-300));
+      }
+      amrex::ParallelDescriptor::ReduceRealMax(t_cell);
+      amrex::ParallelDescriptor::ReduceRealMax(t_batch);
+      amrex::Print() << " Manifold per-cell evaluation: " << npts_tot / t_cell
+                     << " points/s" << std::endl;
+      amrex::Print() << " Manifold batched evaluation:  " << npts_tot / t_batch
+                     << " points/s (speedup " << t_cell / t_batch << ")"
+                     << std::endl;
+      amrex::Print() << " Max relative difference batched vs per-cell: "
+                     << maxdiff << std::endl;
+      if (maxdiff > batch_tol) {
+        amrex::Abort("Batched manifold evaluation differs from per-cell");
+      }
+    }
+
+    int do_deriv_test = 0;
+    pp.query("do_deriv_test", do_deriv_test);
+    if (do_deriv_test != 0) {
+      // Derivatives of each manifold output with respect to the manifold
+      // parameters (get_values_derivs) against central differences. The
+      // networks are piecewise linear, so a small step only has round-off
+      // error unless it crosses a LeakyReLU kink
+      amrex::Real deriv_step = 1.e-7;
+      pp.query("deriv_step", deriv_step);
+      amrex::Real deriv_tol = 1.e-6;
+      pp.query("deriv_tol", deriv_tol);
+      const auto& h_manf_data =
+        eos_parms.host_only_parm().manfunc_par->host_parm();
+      const int ndim = h_manf_data.Ndim;
+      amrex::Real max_err = 0.0;
+      for (int iv = 0; iv < h_manf_data.Nvar; ++iv) {
+        amrex::ReduceOps<amrex::ReduceOpMax, amrex::ReduceOpMax> reduce_op;
+        amrex::ReduceData<amrex::Real, amrex::Real> reduce_data(reduce_op);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+        for (amrex::MFIter mfi(mass_frac, amrex::TilingIfNotGPU());
+             mfi.isValid(); ++mfi) {
+          const amrex::Box& box = mfi.tilebox();
+          auto const& Y_a = mass_frac.const_array(mfi);
+          reduce_op.eval(
+            box, reduce_data,
+            [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept -> ReduceTuple {
+              pele::physics::BlackBoxFunctionFactory<
+                pele::physics::eos::ManifoldFunctionType>
+                manfunc(leosparm->manf_data);
+              auto* func = manfunc.get_func();
+              amrex::Real x[NUM_SPECIES];
+              for (int n = 0; n < NUM_SPECIES; ++n) {
+                x[n] = Y_a(i, j, k, n);
+              }
+              amrex::Real val;
+              amrex::Real derivs[NUM_SPECIES];
+              func->get_values_derivs(1, &iv, x, &val, derivs);
+              amrex::Real dmax = 0.0;
+              amrex::Real err = 0.0;
+              for (int d = 0; d < ndim; ++d) {
+                const amrex::Real xd = x[d];
+                const amrex::Real h =
+                  deriv_step * amrex::max(1.0, std::abs(xd));
+                amrex::Real fp, fm;
+                x[d] = xd + h;
+                func->get_value(iv, x, fp);
+                const amrex::Real xp = x[d];
+                x[d] = xd - h;
+                func->get_value(iv, x, fm);
+                const amrex::Real fd = (fp - fm) / (xp - x[d]);
+                x[d] = xd;
+                dmax = amrex::max(dmax, std::abs(derivs[d]));
+                err = amrex::max(err, std::abs(derivs[d] - fd));
+              }
+              return {dmax, err};
+            });
+        }
+        auto hv = reduce_data.value(reduce_op);
+        amrex::Real dmax = amrex::get<0>(hv);
+        amrex::Real err = amrex::get<1>(hv);
+        amrex::ParallelDescriptor::ReduceRealMax(dmax);
+        amrex::ParallelDescriptor::ReduceRealMax(err);
+        if (dmax > 0.0) {
+          max_err = amrex::max(max_err, err / dmax);
+        }
+      }
+      amrex::Print() << " Max relative difference of manifold derivatives vs "
+                        "central differences: "
+                     << max_err << std::endl;
+      if (max_err > deriv_tol) {
+        amrex::Abort("Manifold derivatives do not match central differences");
+      }
+    }
+
+    int do_table_bench = 0;
+    pp.query("do_table_bench", do_table_bench);
+    if (do_table_bench != 0) {
+      // Lookups of all variables of each table, with bisection or direct grid
+      // location, stored variable-major or point-major, with one search per
+      // variable or a single query reused for all variables, and with cubic
+      // interpolation
+      using pele::physics::TabulatedFunction;
+      using pele::physics::TabulatedFunctionData;
+      using TableParams = pele::physics::PeleParams<
+        TabulatedFunctionData, pele::physics::BlackBoxFunctionData>;
+      using TableInit = pele::physics::InitParm<
+        TabulatedFunctionData, pele::physics::BlackBoxFunctionData>;
+      amrex::Vector<std::string> tables;
+      pp.getarr("table_bench_files", tables);
+      int nlookup = 1 << 18;
+      pp.query("table_bench_npts", nlookup);
+      int nbench = 10;
+      pp.query("nbench", nbench);
+      // Precision of the direct location variants. The bisection variant is
+      // always in real precision and is the reference of the others, which
+      // agree with it to roundoff, or for reduced precision to the rounding
+      // of the stored values: the float epsilon, or half a 16 bit step of
+      // the range of each variable, at most its magnitude / 65535
+      std::string bench_precision = "real";
+      pp.query("table_bench_precision", bench_precision);
+      auto precision = pele::physics::TablePrecision::real;
+      amrex::Real linear_tol = 1.e-12;
+      if (bench_precision == "float") {
+        precision = pele::physics::TablePrecision::float32;
+        linear_tol = 1.e-6;
+      } else if (bench_precision == "int16") {
+        precision = pele::physics::TablePrecision::int16;
+        linear_tol = 1.0 / 65535.0 + 1.e-12;
+      } else if (bench_precision != "real") {
+        amrex::Abort("table_bench_precision must be real, float or int16");
+      }
+      // Quasi-random lookup points, x_n = frac(n * sqrt(prime))
+      const amrex::GpuArray<amrex::Real, MAXD_TABLE> seq{
+        std::sqrt(2.0), std::sqrt(3.0), std::sqrt(5.0), std::sqrt(7.0),
+        std::sqrt(11.0)};
+      // Table configurations: bisection variable-major, direct location
+      // variable-major, direct location point-major (all linear), direct
+      // location variable-major with cubic interpolation
+      constexpr int nconf = 4;
+      constexpr int nlinear = 3;
+      const char* conf_names[nconf] = {
+        "bisection, variable-major", "direct, variable-major",
+        "direct, point-major", "direct, variable-major, cubic"};
+      const char* mode_names[2] = {"search per variable", "single query"};
+      constexpr int nvariant = 2 * nconf;
+
+      for (const auto& tablefile : tables) {
+        amrex::Vector<amrex::Gpu::DeviceVector<amrex::Real>> res(nvariant);
+        amrex::Real times[nvariant];
+        int ndim = 0;
+        int nvar = 0;
+        amrex::Real vscale = 0.0;
+        amrex::Real cubic_bound = 0.0;
+        for (int conf = 0; conf < nconf; ++conf) {
+          TableParams tab;
+          auto& tdata = static_cast<TabulatedFunctionData&>(tab.host_parm());
+          tdata.bbmodel = pele::physics::BlackBoxModel::TABLE;
+          pele::physics::TableLoadOptions opts;
+          opts.point_major = (conf == 2);
+          opts.fast_locate = (conf != 0);
+          if (conf == 1 || conf == 2) {
+            opts.precision = precision;
+          }
+          if (conf == 3) {
+            opts.interp = pele::physics::TableInterp::cubic;
+          }
+          TableInit::read_table(tablefile, tdata, opts);
+          if (conf == 0) {
+            vscale = table_value_scale(tdata);
+          } else if (conf == 3) {
+            cubic_bound = table_hermite_bound(tdata);
+          }
+          tab.device_allocate();
+          const auto* dtab =
+            static_cast<const TabulatedFunctionData*>(tab.device_parm());
+          ndim = tdata.Ndim;
+          nvar = tdata.Nvar;
+          amrex::GpuArray<amrex::Real, MAXD_TABLE> lo{0.0};
+          amrex::GpuArray<amrex::Real, MAXD_TABLE> len{0.0};
+          int start = 0;
+          for (int d = 0; d < ndim; ++d) {
+            const int npts_d = tdata.dimLengths[d];
+            lo[d] = tdata.grids[start];
+            len[d] = tdata.grids[start + npts_d - 1] - lo[d];
+            start += npts_d;
+          }
+
+          for (int mode = 0; mode < 2; ++mode) {
+            auto& r = res[2 * conf + mode];
+            r.resize(nlookup);
+            auto* out = r.data();
+            amrex::Gpu::synchronize();
+            amrex::Real t0 = amrex::second();
+            for (int ib = 0; ib < nbench; ++ib) {
+              BL_PROFILE("Pele::table_lookups()");
+              amrex::ParallelFor(
+                nlookup, [=] AMREX_GPU_DEVICE(int n) noexcept {
+                  amrex::Real x[MAXD_TABLE];
+                  for (int d = 0; d < ndim; ++d) {
+                    const amrex::Real s = (n + 0.5) * seq[d];
+                    x[d] = lo[d] + len[d] * (s - std::floor(s));
+                  }
+                  amrex::Real sum = 0.0;
+                  amrex::Real val = 0.0;
+                  if (mode == 0) {
+                    for (int iv = 0; iv < nvar; ++iv) {
+                      TabulatedFunction<> tf(dtab);
+                      tf.get_value(iv, x, val);
+                      sum += val;
+                    }
+                  } else {
+                    TabulatedFunction<> tf(dtab);
+                    TabulatedFunction<>::query_type q;
+                    tf.locate_query(x, q);
+                    for (int iv = 0; iv < nvar; ++iv) {
+                      tf.get_value_at(q, iv, val);
+                      sum += val;
+                    }
+                  }
+                  out[n] = sum;
+                });
+            }
+            amrex::Gpu::synchronize();
+            times[2 * conf + mode] = amrex::second() - t0;
+          }
+          tab.deallocate();
+        }
+
+        // All linear variants must give the same results up to the precision
+        // of their values, cubic ones only agree with them to the
+        // interpolation error
+        const auto* ref = res[0].data();
+        amrex::Real maxdiff = 0.0;
+        amrex::Real cubicdiff = 0.0;
+        for (int iv = 1; iv < nvariant; ++iv) {
+          const auto* cmp = res[iv].data();
+          amrex::Real& diff = (iv < 2 * nlinear) ? maxdiff : cubicdiff;
+          diff = amrex::max(
+            diff, amrex::Reduce::Max<amrex::Real>(
+                    nlookup, [=] AMREX_GPU_DEVICE(int n) noexcept {
+                      return std::abs(cmp[n] - ref[n]);
+                    }));
+        }
+        const amrex::Real nval = static_cast<amrex::Real>(nlookup) * nbench;
+        amrex::Print() << " Table " << tablefile << " (" << ndim << "D, "
+                       << nvar << " variables):" << std::endl;
+        for (int iv = 0; iv < nvariant; ++iv) {
+          amrex::ParallelDescriptor::ReduceRealMax(times[iv]);
+          amrex::Print() << "   " << conf_names[iv / 2] << ", "
+                         << mode_names[iv % 2] << ": "
+                         << nval * nvar / times[iv] << " lookups/s, "
+                         << nval / times[iv] << " points/s" << std::endl;
+        }
+        amrex::Print() << "   Max difference between linear variants ("
+                       << bench_precision << " precision): " << maxdiff
+                       << std::endl;
+        amrex::Print() << "   Max difference between cubic and linear: "
+                       << cubicdiff << " (bound " << cubic_bound << ")"
+                       << std::endl;
+        if (maxdiff > linear_tol * vscale) {
+          amrex::Abort("Linear table lookup variants differ for " + tablefile);
+        }
+        if (cubicdiff > cubic_bound + 1.e-12 * vscale) {
+          amrex::Abort(
+            "Cubic table lookups exceed the interpolation error bound for " +
+            tablefile);
+        }
+      }
+    }
+#endif
+
     if (do_plot) {
       amrex::MultiFab VarPlt(ba, dm, 4 + 2 * NUM_SPECIES, num_grow);
       amrex::MultiFab::Copy(VarPlt, density, 0, 0, 1, num_grow);
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <string>
+
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+
+#include <Filter.H>
+
+using namespace amrex;
+
+// Largest difference between the components of two MultiFabs
+Real
+max_difference(const MultiFab& a, const MultiFab& b, const int ncomp)
+{
+  MultiFab diff(a.boxArray(), a.DistributionMap(), ncomp, 0);
+  MultiFab::Copy(diff, a, 0, 0, ncomp, 0);
+  MultiFab::Subtract(diff, b, 0, 0, ncomp, 0);
+  Real maxdiff = 0.0;
+  for (int n = 0; n < ncomp; n++) {
+    maxdiff = amrex::max(maxdiff, diff.norm0(n));
+  }
+  return maxdiff;
+}
+
+int
+main(int argc, char* argv[])
+{
+  Initialize(argc, argv);
+  {
+    BL_PROFILE("main::main()");
+
+    ParmParse pp;
+    int n_cell = 128;
+    pp.query("n_cell", n_cell);
+    int max_grid_size = 64;
+    pp.query("max_grid_size", max_grid_size);
+    int ncomp = 5;
+    pp.query("ncomp", ncomp);
+    Vector<int> filter_types{box, gaussian};
+    pp.queryarr("filter_types", filter_types);
+    Vector<int> filter_widths{4, 6, 8, 10, 12};
+    pp.queryarr("filter_widths", filter_widths);
+    int nbench = 5;
+    pp.query("nbench", nbench);
+    // The approximate filters have a fixed stencil whatever their width
+    int max_ngrow = 0;
+    for (const int filter_type : filter_types) {
+      for (const int fgr : filter_widths) {
+        max_ngrow = amrex::max(
+          max_ngrow, Filter(filter_type, fgr).get_filter_ngrow());
+      }
+    }
+
+    const Box domain(IntVect(0), IntVect(n_cell - 1));
+    BoxArray ba(domain);
+    ba.maxSize(max_grid_size);
+    const DistributionMapping dm(ba);
+
+    // Smooth data with some small scale noise, including the ghost cells
+    MultiFab in(ba, dm, ncomp, max_ngrow);
+    auto const& ina = in.arrays();
+    ParallelFor(
+      in, in.nGrowVect(), ncomp,
+      [=] AMREX_GPU_DEVICE(int nbx, int i, int j, int k, int n) noexcept {
+        ina[nbx](i, j, k, n) =
+          std::sin(0.1 * (n + 1) * i) * std::cos(0.07 * j + 0.05 * k) +
+          0.01 * ((7 * i + 13 * j + 17 * k + 3 * n) % 11);
+      });
+    MultiFab out_full(ba, dm, ncomp, 0);
+    MultiFab out_sep(ba, dm, ncomp, 0);
+
+    Print() << " Filtering " << ncomp << " components on " << n_cell
+            << "^3 cells" << std::endl;
+    for (const int filter_type : filter_types) {
+      for (const int fgr : filter_widths) {
+        Filter les_filter(filter_type, fgr);
+        const int ngrow = les_filter.get_filter_ngrow();
+
+        les_filter.set_separable(false);
+        Real t0 = ParallelDescriptor::second();
+        for (int ib = 0; ib < nbench; ib++) {
+          les_filter.apply_filter(in, out_full);
+        }
+        const Real t_full = (ParallelDescriptor::second() - t0) / nbench;
+
+        les_filter.set_separable(true);
+        t0 = ParallelDescriptor::second();
+        for (int ib = 0; ib < nbench; ib++) {
+          les_filter.apply_filter(in, out_sep);
+        }
+        const Real t_sep = (ParallelDescriptor::second() - t0) / nbench;
+
+        // In place filtering of a copy, with just enough grow cells
+        MultiFab inplace(ba, dm, ncomp, ngrow);
+        MultiFab::Copy(inplace, in, 0, 0, ncomp, ngrow);
+        les_filter.apply_filter_inplace(inplace, 0, ncomp);
+
+        const Real sep_diff = max_difference(out_full, out_sep, ncomp);
+        const Real inplace_diff = max_difference(inplace, out_sep, ncomp);
+        Print() << "   type " << filter_type << ", width " << fgr
+                << ", ngrow " << ngrow << ": full stencil " << t_full
+                << " s, separable " << t_sep << " s, speedup "
+                << t_full / t_sep << ", max difference " << sep_diff
+                << ", in place max difference " << inplace_diff << std::endl;
+        // The data and the filtered data are of order one
+        if (sep_diff > 1.e-12 || inplace_diff > 1.e-12) {
+          Abort(
+            "Separable or in place filtering differs from the full stencil "
+            "for filter type " +
+            std::to_string(filter_type));
+        }
+      }
+    }
+  }
+  Finalize();
+
+  return 0;
+}
@@ -13,6 +13,7 @@
 #endif
 
 #include "mechanism.H"
+#include <PMF.H>
 #include <PMFData.H>
 #include <data_K.H>
 
@@ -81,6 +82,50 @@ main(int argc, char* argv[])
         initdata(i, j, k, sma[box_no], standoff, geomdata, lpmfdata);
       });
 
+    // Fill the PMF values box by box, with one PMF evaluation per cell index
+    // along the flame direction, and compare with evaluations per cell
+    const int pmf_dir = AMREX_SPACEDIM - 1;
+    const int npmf = NUM_SPECIES + 3;
+    const Real x0 = (geom.ProbLo(pmf_dir) - standoff) * 100;
+    const Real dxpmf = geom.CellSize(pmf_dir) * 100;
+    MultiFab pmfBox(grids, dmaps, npmf, num_grow);
+    MultiFab pmfCell(grids, dmaps, npmf, num_grow);
+    Gpu::synchronize();
+    Real t0 = ParallelDescriptor::second();
+    for (MFIter mfi(pmfBox); mfi.isValid(); ++mfi) {
+      pele::physics::PMF::pmf_fill(
+        lpmfdata, mfi.validbox(), pmf_dir, x0, dxpmf, pmfBox.array(mfi));
+    }
+    Gpu::synchronize();
+    const Real t_box = ParallelDescriptor::second() - t0;
+    t0 = ParallelDescriptor::second();
+    auto const& pca = pmfCell.arrays();
+    amrex::ParallelFor(
+      pmfCell, [=] AMREX_GPU_DEVICE(int box_no, int i, int j, int k) noexcept {
+        const IntVect iv(AMREX_D_DECL(i, j, k));
+        const Real xlo = x0 + iv[pmf_dir] * dxpmf;
+        GpuArray<Real, NUM_SPECIES + 4> pmf_vals = {0.0};
+        pele::physics::PMF::pmf(lpmfdata, xlo, xlo + dxpmf, pmf_vals);
+        for (int n = 0; n < npmf; n++) {
+          pca[box_no](i, j, k, n) = pmf_vals[n];
+        }
+      });
+    Gpu::synchronize();
+    const Real t_cell = ParallelDescriptor::second() - t0;
+    // Both evaluate the PMF on the same cell bounds, so they only differ by
+    // roundoff, relative to the magnitude of each variable
+    MultiFab::Subtract(pmfCell, pmfBox, 0, 0, npmf, num_grow);
+    Real maxdiff = 0.0;
+    for (int n = 0; n < npmf; n++) {
+      maxdiff = amrex::max(
+        maxdiff, pmfCell.norm0(n) / amrex::max(pmfBox.norm0(n), 1.e-300));
+    }
+    Print() << " PMF fill per box: " << t_box << " s, per cell: " << t_cell
+            << " s, max relative difference: " << maxdiff << "\n";
+    if (maxdiff > 1.e-12) {
+      Abort("PMF fill per box differs from the PMF per cell");
+    }
+
     // Print data
     std::string outfile = "pltInitData";
     Vector<int> isteps(1, 0);
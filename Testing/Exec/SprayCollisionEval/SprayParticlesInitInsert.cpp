@@ -0,0 +1,19 @@
+#include "SprayParticles.H"
+
+// Parcels are created directly in main.cpp
+
+bool
+SprayParticleContainer::injectParticles(
+  amrex::Real /*time*/,
+  amrex::Real /*dt*/,
+  int /*nstep*/,
+  int /*lev*/,
+  int /*finest_level*/)
+{
+  return false;
+}
+
+void
+SprayParticleContainer::InitSprayParticles(const bool /*init_parts*/)
+{
+}
@@ -0,0 +1,230 @@
+#include <iostream>
+
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+
+#include "mechanism.H"
+#include <PelePhysics.H>
+#include "SprayParticles.H"
+#include "SprayCollision.H"
+
+using namespace amrex;
+
+using PType = SprayParticleContainer::ParticleType;
+
+// Liquid mass, momentum in each direction, and total energy of parcels
+using ParcelTotals = Array<Real, AMREX_SPACEDIM + 2>;
+
+// Cell of parcel pid for a dense injector: dense_pct percent of the parcels
+// are in the inj_cells cells next to the injector, the others are spread over
+// the collision box
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+IntVect
+injector_cell(
+  const int pid, const int dense_pct, const int inj_cells, const IntVect& len)
+{
+  const int ncells = AMREX_D_TERM(len[0], *len[1], *len[2]);
+  const int c = (pid % 100 < dense_pct) ? pid % inj_cells : pid % ncells;
+  return IntVect(AMREX_D_DECL(
+    c % len[0], (c / len[0]) % len[1], c / (len[0] * len[1])));
+}
+
+// Totals of the first np parcels
+ParcelTotals
+parcel_totals(const int np, const SprayTileData& ptd, const SprayData* fdat)
+{
+  ReduceOps<
+    ReduceOpSum, AMREX_D_DECL(ReduceOpSum, ReduceOpSum, ReduceOpSum),
+    ReduceOpSum>
+    reduce_op;
+  ReduceData<Real, AMREX_D_DECL(Real, Real, Real), Real> reduce_data(
+    reduce_op);
+  using ReduceTuple = typename decltype(reduce_data)::Type;
+  reduce_op.eval(
+    np, reduce_data, [=] AMREX_GPU_DEVICE(int pid) -> ReduceTuple {
+      SprayParcel p = ptd[pid];
+      if (p.id() <= 0) {
+        return {0.0, AMREX_D_DECL(0.0, 0.0, 0.0), 0.0};
+      }
+      Real cp_part = 0.0;
+      const Real pmass = parcelMass(p, *fdat, cp_part);
+      RealVect mom;
+      Real ke = 0.0;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        const Real u = p.rdata(SprayComps::pstateVel + dir);
+        mom[dir] = pmass * u;
+        ke += 0.5 * pmass * u * u;
+      }
+      return {
+        pmass, AMREX_D_DECL(mom[0], mom[1], mom[2]),
+        pmass * cp_part * p.rdata(SprayComps::pstateT) + ke};
+    });
+  auto hv = reduce_data.value(reduce_op);
+  return ParcelTotals{
+    amrex::get<0>(hv),
+    AMREX_D_DECL(amrex::get<1>(hv), amrex::get<2>(hv), amrex::get<3>(hv)),
+    amrex::get<AMREX_SPACEDIM + 1>(hv)};
+}
+
+// Largest relative change of the parcel totals, with each momentum component
+// relative to the magnitude of the initial momentum
+Real
+totals_err(const ParcelTotals& tot0, const ParcelTotals& tot1)
+{
+  Real mom0 = 0.0;
+  for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+    mom0 += tot0[1 + dir] * tot0[1 + dir];
+  }
+  mom0 = std::sqrt(mom0);
+  Real err = std::abs(tot1[0] - tot0[0]) / tot0[0];
+  for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+    err = amrex::max(err, std::abs(tot1[1 + dir] - tot0[1 + dir]) / mom0);
+  }
+  const int ie = AMREX_SPACEDIM + 1;
+  return amrex::max(err, std::abs(tot1[ie] - tot0[ie]) / tot0[ie]);
+}
+
+int
+main(int argc, char* argv[])
+{
+  Initialize(argc, argv);
+  {
+    BL_PROFILE("main::main()");
+
+    ParmParse pp;
+    int nparcels = 100000;
+    pp.query("nparcels", nparcels);
+    int nrep = 10;
+    pp.query("nrep", nrep);
+    Real dt = 1.e-6;
+    pp.query("dt", dt);
+    Real T_part = 300.0;
+    pp.query("T_part", T_part);
+    Real dia_lo = 1.e-3;
+    pp.query("dia_lo", dia_lo);
+    Real dia_hi = 1.e-2;
+    pp.query("dia_hi", dia_hi);
+    Real u_part = 1000.0;
+    pp.query("u_part", u_part);
+    int coll_ncell = 16;
+    pp.query("coll_ncell", coll_ncell);
+    Real coll_dx = 0.05;
+    pp.query("coll_dx", coll_dx);
+    int inj_cells = 4;
+    pp.query("inj_cells", inj_cells);
+    int dense_pct = 90;
+    pp.query("dense_pct", dense_pct);
+
+    pele::physics::PeleParams<
+      pele::physics::eos::EosParm<pele::physics::PhysicsType::eos_type>>
+      eos_parms;
+    eos_parms.initialize();
+
+    int verbose = 0;
+    SprayParticleContainer::readSprayParams(verbose);
+    const Real body_force[AMREX_SPACEDIM] = {AMREX_D_DECL(0.0, 0.0, 0.0)};
+    SprayParticleContainer::spraySetup(body_force);
+    const SprayData* fdat_h = SprayParticleContainer::getSprayData();
+    if (fdat_h->do_collision == 0) {
+      Abort("particles.use_collision_model must be set");
+    }
+    Gpu::DeviceVector<SprayData> fdat_d(1);
+    Gpu::copy(Gpu::hostToDevice, fdat_h, fdat_h + 1, fdat_d.begin());
+    const auto* fdat = fdat_d.data();
+
+    // Parcels with the spray components laid out as in the particle tiles
+    Gpu::DeviceVector<PType> parts_d(nparcels);
+    Gpu::DeviceVector<ParticleReal> soa_d(
+      static_cast<Long>(NAR_SPR) * nparcels);
+    Array<ParticleReal*, SprayComps::pstateNum> rdata_d = {{nullptr}};
+    for (int n = 0; n < NAR_SPR; ++n) {
+      rdata_d[n] = soa_d.data() + static_cast<Long>(n) * nparcels;
+    }
+    const SprayTileData ptd(parts_d.data(), rdata_d.data());
+
+    // Droplet collisions near a dense injector, for increasing numbers of
+    // parcels in the same cells, to measure how the cost of the collision step
+    // grows with the number of parcels. Collisions must keep the liquid mass,
+    // momentum, and total energy of the parcels
+    const Box coll_box(
+      IntVect::TheZeroVector(),
+      IntVect(AMREX_D_DECL(coll_ncell - 1, coll_ncell - 1, coll_ncell - 1)));
+    const IntVect coll_len = coll_box.length();
+    const RealVect coll_plo(AMREX_D_DECL(0.0, 0.0, 0.0));
+    const RealVect coll_dxi(
+      AMREX_D_DECL(1.0 / coll_dx, 1.0 / coll_dx, 1.0 / coll_dx));
+    Gpu::DeviceVector<Long> coll_stats_d(2);
+    Long* coll_stats = coll_stats_d.data();
+    Vector<int> coll_np;
+    Vector<Real> coll_time;
+    Vector<Long> coll_events;
+    Real coll_err = 0.0;
+    for (int np = amrex::max(nparcels / 8, 2); np <= nparcels; np *= 2) {
+      Real t_coll = 0.0;
+      ParallelFor(
+        2, [=] AMREX_GPU_DEVICE(int n) noexcept { coll_stats[n] = 0; });
+      for (int rep = 0; rep < nrep; ++rep) {
+        ParallelForRNG(
+          np,
+          [=] AMREX_GPU_DEVICE(int pid, RandomEngine const& engine) noexcept {
+            SprayParcel p = ptd[pid];
+            p.id() = pid + 1;
+            p.cpu() = 0;
+            for (int n = 0; n < SprayComps::pstateNum; ++n) {
+              p.rdata(n) = 0.0;
+            }
+            const IntVect iv =
+              injector_cell(pid, dense_pct, inj_cells, coll_len);
+            for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+              p.pos(dir) =
+                coll_dx * (static_cast<Real>(iv[dir]) + Random(engine));
+              p.rdata(SprayComps::pstateVel + dir) =
+                u_part * static_cast<Real>((pid + dir) % 11) / 10.0;
+            }
+            p.rdata(SprayComps::pstateT) = T_part + static_cast<Real>(pid % 5);
+            p.rdata(SprayComps::pstateDia) =
+              dia_lo + (dia_hi - dia_lo) * static_cast<Real>(pid % 89) / 88.0;
+            for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+              p.rdata(SprayComps::pstateY + spf) = 1.0 / SPRAY_FUEL_NUM;
+            }
+            p.rdata(SprayComps::pstateNumDens) =
+              static_cast<Real>(1 + pid % 3);
+          });
+        const ParcelTotals tot0 = parcel_totals(np, ptd, fdat);
+        Gpu::streamSynchronize();
+        const Real t0 = ParallelDescriptor::second();
+        collideTileParcels(
+          np, ptd, coll_box, coll_plo, coll_dxi, dt, fdat, coll_stats);
+        t_coll += ParallelDescriptor::second() - t0;
+        const ParcelTotals tot1 = parcel_totals(np, ptd, fdat);
+        coll_err = amrex::max(coll_err, totals_err(tot0, tot1));
+      }
+      Gpu::HostVector<Long> stats_h(2);
+      Gpu::copy(
+        Gpu::deviceToHost, coll_stats_d.begin(), coll_stats_d.end(),
+        stats_h.begin());
+      coll_np.push_back(np);
+      coll_time.push_back(t_coll / nrep);
+      coll_events.push_back(stats_h[0] + stats_h[1]);
+    }
+
+    Print() << " droplet collisions in " << coll_box.numPts() << " cells of "
+            << coll_dx << " cm, " << dense_pct << "% of the parcels in "
+            << inj_cells << " injector cells\n";
+    for (int n = 0; n < static_cast<int>(coll_np.size()); ++n) {
+      Print() << "   " << coll_np[n] << " parcels: " << coll_time[n]
+              << " s per step, " << coll_np[n] / coll_time[n]
+              << " parcels/s, "
+              << static_cast<Real>(coll_events[n]) / nrep
+              << " collisions per step\n";
+    }
+    Print() << "   max relative error:                 " << coll_err << "\n";
+    if (coll_err > 1.e-10) {
+      Abort("Droplet collisions do not conserve mass, momentum or energy");
+    }
+  }
+  Finalize();
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+#include "SprayParticles.H"
+#include "SprayInjection.H"
+
+// Parcels are created directly in main.cpp, and jets are injected with the
+// routines of SprayInjection.H
+
+bool
+SprayParticleContainer::injectParticles(
+  amrex::Real /*time*/,
+  amrex::Real /*dt*/,
+  int /*nstep*/,
+  int /*lev*/,
+  int /*finest_level*/)
+{
+  return false;
+}
+
+void
+SprayParticleContainer::InitSprayParticles(const bool /*init_parts*/)
+{
+}
@@ -0,0 +1,1628 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <AMReX_AmrCore.H>
+#include <AMReX_BCRec.H>
+#include <AMReX_BC_TYPES.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+
+#include "mechanism.H"
+#include <PelePhysics.H>
+#include "SprayParticles.H"
+#include "Drag.H"
+#include "SprayDeposit.H"
+#include "Distributions.H"
+#include "SBChildren.H"
+#include "TABBreakup.H"
+#include "SprayManage.H"
+#include "SprayInterpolation.H"
+
+using namespace amrex;
+
+using PType = SprayParticleContainer::ParticleType;
+
+// Gas phase state seen by parcel pid: a lean fuel/air mixture at 1 atm with
+// the temperature varying between parcels
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+void
+gas_state(
+  const int pid,
+  const Real T_lo,
+  const Real T_hi,
+  const Real u_gas,
+  const GpuArray<Real, NUM_SPECIES>& Y_gas,
+  GasPhaseVals& gpv)
+{
+  auto eos = pele::physics::PhysicsType::eos();
+  gpv.T_fluid = T_lo + (T_hi - T_lo) * static_cast<Real>(pid % 97) / 96.0;
+  for (int n = 0; n < NUM_SPECIES; ++n) {
+    gpv.Y_fluid[n] = Y_gas[n];
+  }
+  eos.PYT2R(
+    pele::physics::Constants::PATM, gpv.Y_fluid.data(), gpv.T_fluid,
+    gpv.rho_fluid);
+  gpv.vel_fluid[0] = u_gas;
+}
+
+// Cell of parcel pid for a dense injector: dense_pct percent of the parcels
+// are in the inj_cells cells next to the injector, the others are spread over
+// the deposition box
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+IntVect
+injector_cell(
+  const int pid, const int dense_pct, const int inj_cells, const IntVect& len)
+{
+  const int ncells = AMREX_D_TERM(len[0], *len[1], *len[2]);
+  const int c = (pid % 100 < dense_pct) ? pid % inj_cells : pid % ncells;
+  return IntVect(AMREX_D_DECL(
+    c % len[0], (c / len[0]) % len[1], c / (len[0] * len[1])));
+}
+
+// Source component comp deposited by parcel pid
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+Real
+parcel_src(const int pid, const int comp)
+{
+  return static_cast<Real>(1 + pid % 7) * static_cast<Real>(comp + 1);
+}
+
+// Components of the gas state of the spray containers, whose sources are laid
+// out as SprayDepComps
+struct EvalGasComps
+{
+  static constexpr int rho = 0;
+  static constexpr int mom = 1;
+  static constexpr int eng = mom + AMREX_SPACEDIM;
+  static constexpr int T = eng + 1;
+  static constexpr int spec = T + 1;
+  static constexpr int num = spec + NUM_SPECIES;
+};
+
+constexpr int mesh_periodic[AMREX_SPACEDIM] = {AMREX_D_DECL(1, 1, 1)};
+
+// Periodic single level mesh of the spray containers, without regridding
+class SprayEvalMesh : public AmrCore
+{
+public:
+  SprayEvalMesh(const RealBox& rb, const int ncell, const int max_grid_size)
+    : AmrCore(
+        &rb, 0, Vector<int>(AMREX_SPACEDIM, ncell), 0, Vector<IntVect>(),
+        mesh_periodic)
+  {
+    SetMaxGridSize(max_grid_size);
+    InitFromScratch(0.0);
+  }
+
+protected:
+  void MakeNewLevelFromScratch(
+    int /*lev*/,
+    Real /*time*/,
+    const BoxArray& /*ba*/,
+    const DistributionMapping& /*dm*/) override
+  {
+  }
+
+  void MakeNewLevelFromCoarse(
+    int /*lev*/,
+    Real /*time*/,
+    const BoxArray& /*ba*/,
+    const DistributionMapping& /*dm*/) override
+  {
+  }
+
+  void RemakeLevel(
+    int /*lev*/,
+    Real /*time*/,
+    const BoxArray& /*ba*/,
+    const DistributionMapping& /*dm*/) override
+  {
+  }
+
+  void ClearLevel(int /*lev*/) override {}
+
+  void ErrorEst(
+    int /*lev*/, TagBoxArray& /*tags*/, Real /*time*/, int /*ngrow*/) override
+  {
+  }
+};
+
+// Gas state of the spray containers, with the state of gas_state for each
+// cell of the domain. Ghost cells take the state of their periodic image
+void
+fill_gas_state(
+  MultiFab& state,
+  const Geometry& geom,
+  const Real T_lo,
+  const Real T_hi,
+  const Real u_gas,
+  const GpuArray<Real, NUM_SPECIES>& Y_gas)
+{
+  const Box domain = geom.Domain();
+  const IntVect len = domain.length();
+  for (MFIter mfi(state); mfi.isValid(); ++mfi) {
+    Array4<Real> const& sa = state.array(mfi);
+    ParallelFor(
+      mfi.fabbox(), [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+        IntVect iv(AMREX_D_DECL(i, j, k));
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          iv[dir] = ((iv[dir] % len[dir]) + len[dir]) % len[dir];
+        }
+        auto eos = pele::physics::PhysicsType::eos();
+        GasPhaseVals gpv;
+        gpv.reset();
+        gas_state(
+          static_cast<int>(domain.index(iv)), T_lo, T_hi, u_gas, Y_gas, gpv);
+        Real e_gas = 0.0;
+        eos.TY2E(gpv.T_fluid, gpv.Y_fluid.data(), e_gas);
+        sa(i, j, k, EvalGasComps::rho) = gpv.rho_fluid;
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          sa(i, j, k, EvalGasComps::mom + dir) =
+            gpv.rho_fluid * gpv.vel_fluid[dir];
+        }
+        sa(i, j, k, EvalGasComps::eng) =
+          gpv.rho_fluid * (e_gas + 0.5 * gpv.vel_fluid.radSquared());
+        sa(i, j, k, EvalGasComps::T) = gpv.T_fluid;
+        for (int n = 0; n < NUM_SPECIES; ++n) {
+          sa(i, j, k, EvalGasComps::spec + n) = gpv.rho_fluid * gpv.Y_fluid[n];
+        }
+      });
+  }
+}
+
+// Parcels of the spray containers: parcel pid is in the cell of
+// injector_cell, at rest or with velocities of up to u_max in each direction
+struct EvalParcels
+{
+  int dense_pct = 90;
+  int inj_cells = 4;
+  Real T_part = 300.0;
+  Real dia_lo = 1.e-3;
+  Real dia_hi = 1.e-2;
+  Real u_max = 0.0;
+
+  // Position, id and spray components of parcel pid
+  void make(
+    const int pid, const Geometry& geom, PType& p, Real* pvals) const
+  {
+    const IntVect len = geom.Domain().length();
+    p.id() = pid + 1;
+    p.cpu() = 0;
+    const IntVect iv = injector_cell(pid, dense_pct, inj_cells, len);
+    for (int n = 0; n < SprayComps::pstateNum; ++n) {
+      pvals[n] = 0.0;
+    }
+    for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+      const Real rx = 0.618034 * static_cast<Real>((pid + 1) * (dir + 1));
+      const Real rv = 0.414214 * static_cast<Real>((pid + 1) * (dir + 2));
+      p.pos(dir) =
+        geom.ProbLo(dir) +
+        (static_cast<Real>(iv[dir]) + rx - std::floor(rx)) * geom.CellSize(dir);
+      pvals[SprayComps::pstateVel + dir] =
+        u_max * (2.0 * (rv - std::floor(rv)) - 1.0);
+    }
+    pvals[SprayComps::pstateT] = T_part;
+    pvals[SprayComps::pstateDia] =
+      dia_lo + (dia_hi - dia_lo) * static_cast<Real>(pid % 89) / 88.0;
+    for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+      pvals[SprayComps::pstateY + spf] = 1.0 / SPRAY_FUEL_NUM;
+    }
+    pvals[SprayComps::pstateNumDens] = 1.0;
+    pvals[SprayComps::pstateN0] = 1.0;
+  }
+};
+
+// Add parcels 0 to np - 1 to level 0 of a spray container, created on the
+// I/O processor
+void
+add_eval_parcels(
+  SprayParticleContainer& pc, const int np, const EvalParcels& parcels)
+{
+  SprayParticleContainer::HostParcelMap host_parts;
+  if (ParallelDescriptor::IOProcessor()) {
+    for (int pid = 0; pid < np; ++pid) {
+      PType p;
+      Real pvals[SprayComps::pstateNum];
+      parcels.make(pid, pc.Geom(0), p, pvals);
+      if (!pc.storeHostParcel(p, pvals, host_parts)) {
+        Abort("Spray parcel outside of the domain");
+      }
+    }
+  }
+  pc.addHostParcels(0, host_parts);
+  pc.Redistribute();
+}
+
+// Positions and spray components of the parcels of level 0 with ids 1 to np,
+// np rows of AMREX_SPACEDIM + SprayComps::pstateNum values on all ranks
+Vector<Real>
+parcel_values_by_id(SprayParticleContainer& pc, const int np)
+{
+  const int ncomp = AMREX_SPACEDIM + SprayComps::pstateNum;
+  Gpu::DeviceVector<Real> vals_d(static_cast<Long>(np) * ncomp, 0.0);
+  Real* vals = vals_d.data();
+  for (auto& kv : pc.GetParticles(0)) {
+    const ConstSprayTileData ptd(kv.second);
+    ParallelFor(
+      static_cast<int>(kv.second.numParticles()),
+      [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        ConstSprayParcel p = ptd[pid];
+        if (p.id() <= 0 || p.id() > np) {
+          return;
+        }
+        Real* v = vals + (static_cast<Long>(p.id()) - 1) * ncomp;
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          v[dir] = p.pos(dir);
+        }
+        for (int n = 0; n < SprayComps::pstateNum; ++n) {
+          v[AMREX_SPACEDIM + n] = p.rdata(n);
+        }
+      });
+  }
+  Vector<Real> vals_h(vals_d.size());
+  Gpu::copy(Gpu::deviceToHost, vals_d.begin(), vals_d.end(), vals_h.begin());
+  ParallelDescriptor::ReduceRealSum(
+    vals_h.data(), static_cast<int>(vals_h.size()));
+  return vals_h;
+}
+
+// Sub-step time step given to parcel id in the checkpoints
+AMREX_GPU_HOST_DEVICE
+AMREX_FORCE_INLINE
+Real
+chk_sub_dt(const Long id)
+{
+  return 1.e-7 * static_cast<Real>(1 + id % 7);
+}
+
+// Write the parcels of level 0 to a checkpoint laid out as before the sub_dt
+// component was added, as read by restartWithoutSubSteps
+void
+write_checkpoint_without_sub_dt(
+  SprayParticleContainer& pc, const std::string& dir)
+{
+#ifdef PELE_SPRAY_SOA
+  using OldPC = ParticleContainer<NSR_SPR, NSI_SPR, NAR_SPR - 1, NAI_SPR>;
+#else
+  using OldPC = ParticleContainer<NSR_SPR - 1, NSI_SPR, NAR_SPR, NAI_SPR>;
+#endif
+  constexpr int nold = SprayComps::pstateNum - 1;
+  OldPC old_pc(pc.GetParGDB());
+  for (auto& kv : pc.GetParticles(0)) {
+    const auto& src = kv.second;
+    const Long np = src.numParticles();
+    if (np == 0) {
+      continue;
+    }
+    auto& dst =
+      old_pc.DefineAndReturnParticleTile(0, kv.first.first, kv.first.second);
+    dst.resize(np);
+    const ConstSprayTileData ptd(src);
+    auto* dst_aos = dst.GetArrayOfStructs()().data();
+#ifdef PELE_SPRAY_SOA
+    GpuArray<ParticleReal*, nold> dst_rdata;
+    for (int n = 0; n < nold; ++n) {
+      dst_rdata[n] = dst.GetStructOfArrays().GetRealData(n).data();
+    }
+#endif
+    ParallelFor(np, [=] AMREX_GPU_DEVICE(Long pid) noexcept {
+      ConstSprayParcel p = ptd[pid];
+      auto& pd = dst_aos[pid];
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        pd.pos(dir) = p.pos(dir);
+      }
+      pd.id() = p.id();
+      pd.cpu() = p.cpu();
+      for (int n = 0; n < nold; ++n) {
+#ifdef PELE_SPRAY_SOA
+        dst_rdata[n][pid] = p.rdata(n);
+#else
+        pd.rdata(n) = p.rdata(n);
+#endif
+      }
+    });
+  }
+  Gpu::streamSynchronize();
+  Vector<std::string> real_comp_names =
+    SprayParticleContainer::sprayCompNames();
+  real_comp_names.pop_back();
+  Vector<std::string> int_comp_names;
+  old_pc.Checkpoint(dir, "particles", true, real_comp_names, int_comp_names);
+}
+
+// Columns of a set of binary spray files, as written by writeBinaryParticles
+// and writeSamplePlanes
+struct BinaryColumns
+{
+  Long count = 0;
+  std::map<std::string, Vector<ParticleReal>> reals;
+  std::map<std::string, Vector<Long>> ints;
+};
+
+// Read the Header and the columns of a set of binary spray files. The id
+// and cpu columns hold integers
+BinaryColumns
+read_binary_columns(const std::string& bin_dir)
+{
+  const std::string header_name = bin_dir + "/Header";
+  std::ifstream header(header_name.c_str());
+  if (!header.good()) {
+    FileOpenFailed(header_name);
+  }
+  std::string version;
+  int ncol = 0;
+  BinaryColumns cols;
+  header >> version >> ncol >> cols.count;
+  if (version != "PeleSprayBinary_v1") {
+    Abort("Unknown binary spray file version " + version);
+  }
+  for (int c = 0; c < ncol; ++c) {
+    std::string name;
+    int nbytes = 0;
+    header >> name >> nbytes;
+    const bool is_int = (name == "id" || name == "cpu");
+    if (
+      static_cast<std::size_t>(nbytes) !=
+      (is_int ? sizeof(Long) : sizeof(ParticleReal))) {
+      Abort("Binary spray column " + name + " has the wrong value size");
+    }
+    const std::string fname = bin_dir + "/" + name + ".bin";
+    std::ifstream file(fname.c_str(), std::ios::binary | std::ios::ate);
+    if (!file.good()) {
+      FileOpenFailed(fname);
+    }
+    if (static_cast<Long>(file.tellg()) != cols.count * nbytes) {
+      Abort("Binary spray column " + name + " has the wrong size");
+    }
+    file.seekg(0);
+    char* data = nullptr;
+    if (is_int) {
+      cols.ints[name].resize(cols.count);
+      data = reinterpret_cast<char*>(cols.ints[name].data());
+    } else {
+      cols.reals[name].resize(cols.count);
+      data = reinterpret_cast<char*>(cols.reals[name].data());
+    }
+    file.read(data, static_cast<std::streamsize>(cols.count * nbytes));
+  }
+  return cols;
+}
+
+int
+main(int argc, char* argv[])
+{
+  Initialize(argc, argv);
+  {
+    BL_PROFILE("main::main()");
+
+    ParmParse pp;
+    int nparcels = 100000;
+    pp.query("nparcels", nparcels);
+    int nrep = 10;
+    pp.query("nrep", nrep);
+    Real dt = 1.e-6;
+    pp.query("dt", dt);
+    Real T_gas_lo = 800.0;
+    pp.query("T_gas_lo", T_gas_lo);
+    Real T_gas_hi = 1500.0;
+    pp.query("T_gas_hi", T_gas_hi);
+    Real u_gas = 1000.0;
+    pp.query("u_gas", u_gas);
+    Real Y_fuel_gas = 0.01;
+    pp.query("Y_fuel_gas", Y_fuel_gas);
+    Real T_part = 300.0;
+    pp.query("T_part", T_part);
+    Real dia_lo = 1.e-3;
+    pp.query("dia_lo", dia_lo);
+    Real dia_hi = 1.e-2;
+    pp.query("dia_hi", dia_hi);
+    int dep_ncell = 16;
+    pp.query("dep_ncell", dep_ncell);
+    int dep_inj_cells = 4;
+    pp.query("dep_inj_cells", dep_inj_cells);
+    int dep_dense_pct = 90;
+    pp.query("dep_dense_pct", dep_dense_pct);
+    int interp_sub = 4;
+    pp.query("interp_sub", interp_sub);
+
+    pele::physics::PeleParams<pele::physics::transport::TransParm<
+      pele::physics::PhysicsType::eos_type,
+      pele::physics::PhysicsType::transport_type>>
+      trans_parms;
+    pele::physics::PeleParams<
+      pele::physics::eos::EosParm<pele::physics::PhysicsType::eos_type>>
+      eos_parms;
+    eos_parms.initialize();
+    trans_parms.initialize();
+
+    int verbose = 0;
+    SprayParticleContainer::readSprayParams(verbose);
+    const Real body_force[AMREX_SPACEDIM] = {AMREX_D_DECL(0.0, 0.0, 0.0)};
+    SprayParticleContainer::spraySetup(body_force);
+    const SprayData* fdat_h = SprayParticleContainer::getSprayData();
+    Gpu::DeviceVector<SprayData> fdat_d(1);
+    Gpu::copy(Gpu::hostToDevice, fdat_h, fdat_h + 1, fdat_d.begin());
+
+    // Air with some fuel vapor
+    GpuArray<Real, NUM_SPECIES> Y_gas = {{0.0}};
+    Real Y_air = 1.0;
+    for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+      Y_gas[fdat_h->indx[spf]] = Y_fuel_gas / SPRAY_FUEL_NUM;
+      Y_air -= Y_fuel_gas / SPRAY_FUEL_NUM;
+    }
+    Y_gas[O2_ID] += 0.233 * Y_air;
+    Y_gas[N2_ID] += 0.767 * Y_air;
+
+    // Parcels at rest with a range of diameters, with the spray components
+    // laid out as in the particle tiles
+    Gpu::HostVector<PType> parts_h(nparcels);
+    Gpu::HostVector<ParticleReal> soa_h(static_cast<Long>(NAR_SPR) * nparcels);
+    Array<ParticleReal*, SprayComps::pstateNum> rdata_h = {{nullptr}};
+    for (int n = 0; n < NAR_SPR; ++n) {
+      rdata_h[n] = soa_h.data() + static_cast<Long>(n) * nparcels;
+    }
+    const SprayTileData ptd_h(parts_h.data(), rdata_h.data());
+    for (int pid = 0; pid < nparcels; ++pid) {
+      PType& ps = parts_h[pid];
+      ps.id() = pid + 1;
+      ps.cpu() = 0;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        ps.pos(dir) = 0.0;
+      }
+      SprayParcel p = ptd_h[pid];
+      for (int n = 0; n < SprayComps::pstateNum; ++n) {
+        p.rdata(n) = 0.0;
+      }
+      p.rdata(SprayComps::pstateT) = T_part;
+      p.rdata(SprayComps::pstateDia) =
+        dia_lo + (dia_hi - dia_lo) * static_cast<Real>(pid % 89) / 88.0;
+      for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+        p.rdata(SprayComps::pstateY + spf) = 1.0 / SPRAY_FUEL_NUM;
+      }
+      p.rdata(SprayComps::pstateNumDens) = 1.0;
+    }
+    Gpu::DeviceVector<PType> parts_d(nparcels);
+    Gpu::DeviceVector<ParticleReal> soa_d(soa_h.size());
+    Array<ParticleReal*, SprayComps::pstateNum> rdata_d = {{nullptr}};
+    for (int n = 0; n < NAR_SPR; ++n) {
+      rdata_d[n] = soa_d.data() + static_cast<Long>(n) * nparcels;
+    }
+    const SprayTileData ptd(parts_d.data(), rdata_d.data());
+    auto copy_parcels = [&]() {
+      Gpu::copy(
+        Gpu::hostToDevice, parts_h.begin(), parts_h.end(), parts_d.begin());
+      Gpu::copy(Gpu::hostToDevice, soa_h.begin(), soa_h.end(), soa_d.begin());
+    };
+
+    const auto* fdat = fdat_d.data();
+    auto const* ltransparm = trans_parms.device_parm();
+
+    // Skin transport, as evaluated by calculateSpraySource: all the species
+    // diffusivities against only those of the fuel species
+    const int nres = 2 + SPRAY_FUEL_NUM;
+    Gpu::DeviceVector<Real> res_full(nres * nparcels);
+    Gpu::DeviceVector<Real> res_fuel(nres * nparcels);
+    Real t_full = 0.0;
+    Real t_fuel = 0.0;
+    for (int rep = 0; rep < nrep; ++rep) {
+      for (int pass = 0; pass < 2; ++pass) {
+        const bool all_spec = (pass == 0);
+        Real* res = all_spec ? res_full.data() : res_fuel.data();
+        Gpu::streamSynchronize();
+        const Real t0 = ParallelDescriptor::second();
+        ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+          GasPhaseVals gpv;
+          gas_state(pid, T_gas_lo, T_gas_hi, u_gas, Y_gas, gpv);
+          // Skin mixture of fuel vapor and gas with the one-third rule
+          const Real T_skin = T_part + (gpv.T_fluid - T_part) / 3.0;
+          GpuArray<Real, NUM_SPECIES> Y_skin;
+          for (int n = 0; n < NUM_SPECIES; ++n) {
+            Y_skin[n] = 0.7 * gpv.Y_fluid[n];
+          }
+          for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+            Y_skin[fdat->indx[spf]] += 0.3 / SPRAY_FUEL_NUM;
+          }
+          Real rho_skin = 0.0;
+          auto eos = pele::physics::PhysicsType::eos();
+          eos.PYT2R(
+            pele::physics::Constants::PATM, Y_skin.data(), T_skin, rho_skin);
+          GpuArray<Real, NUM_SPECIES> Ddiag = {{0.0}};
+          Real mu = 0.0;
+          Real lam = 0.0;
+          auto trans = pele::physics::PhysicsType::transport();
+          if (all_spec) {
+            Real xi = 0.0;
+            trans.transport(
+              false, true, true, true, false, T_skin, rho_skin, Y_skin.data(),
+              Ddiag.data(), nullptr, mu, xi, lam, ltransparm);
+          } else {
+            trans.transport_species(
+              true, true, SPRAY_FUEL_NUM, fdat->indx.data(), T_skin, rho_skin,
+              Y_skin.data(), Ddiag.data(), mu, lam, ltransparm);
+          }
+          res[nres * pid] = mu;
+          res[nres * pid + 1] = lam;
+          for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+            res[nres * pid + 2 + spf] = Ddiag[fdat->indx[spf]];
+          }
+        });
+        Gpu::streamSynchronize();
+        (all_spec ? t_full : t_fuel) += ParallelDescriptor::second() - t0;
+      }
+    }
+    Gpu::HostVector<Real> full_h(res_full.size());
+    Gpu::HostVector<Real> fuel_h(res_fuel.size());
+    Gpu::copy(
+      Gpu::deviceToHost, res_full.begin(), res_full.end(), full_h.begin());
+    Gpu::copy(
+      Gpu::deviceToHost, res_fuel.begin(), res_fuel.end(), fuel_h.begin());
+    Real maxdiff = 0.0;
+    for (int i = 0; i < static_cast<int>(full_h.size()); ++i) {
+      maxdiff = amrex::max(
+        maxdiff, std::abs(fuel_h[i] - full_h[i]) / std::abs(full_h[i]));
+    }
+    if (maxdiff > 1.e-12) {
+      Abort("Fuel-only skin transport differs from full transport");
+    }
+
+    // Parcel update: advance the position, velocity, temperature and diameter
+    // of each parcel, which streams the hot components of every parcel
+    copy_parcels();
+    Real t_upd = 0.0;
+    for (int rep = 0; rep < nrep; ++rep) {
+      Gpu::streamSynchronize();
+      const Real t0 = ParallelDescriptor::second();
+      ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        SprayParcel p = ptd[pid];
+        if (p.id() > 0) {
+          const Real tau = 1.e-3 * p.rdata(SprayComps::pstateDia);
+          for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+            const Real u_rel =
+              ((dir == 0) ? u_gas : 0.0) - p.rdata(SprayComps::pstateVel + dir);
+            p.rdata(SprayComps::pstateVel + dir) += dt * u_rel / tau;
+            p.pos(dir) += dt * p.rdata(SprayComps::pstateVel + dir);
+          }
+          p.rdata(SprayComps::pstateT) +=
+            dt * (T_gas_lo - p.rdata(SprayComps::pstateT)) / tau;
+          p.rdata(SprayComps::pstateDia) *=
+            1.0 - 1.e-6 * p.rdata(SprayComps::pstateNumDens);
+        }
+      });
+      Gpu::streamSynchronize();
+      t_upd += ParallelDescriptor::second() - t0;
+    }
+
+    // Complete evaporation kernel
+    Real t_src = 0.0;
+    Real mass_src = 0.0;
+    Long src_nsub = 0;
+    int src_max_sub = 0;
+    for (int rep = 0; rep < nrep; ++rep) {
+      copy_parcels();
+      Gpu::streamSynchronize();
+      const Real t0 = ParallelDescriptor::second();
+      ReduceOps<ReduceOpSum, ReduceOpSum, ReduceOpMax> reduce_op;
+      ReduceData<Real, Long, int> reduce_data(reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      reduce_op.eval(
+        nparcels, reduce_data, [=] AMREX_GPU_DEVICE(int pid) -> ReduceTuple {
+          SprayParcel p = ptd[pid];
+          auto eos = pele::physics::PhysicsType::eos();
+          SprayUnits SPU;
+          GasPhaseVals gpv;
+          GpuArray<Real, SPRAY_FUEL_NUM> cBoilT;
+          eos.molecular_weight(gpv.mw.data());
+          for (int n = 0; n < NUM_SPECIES; ++n) {
+            gpv.mw[n] *= SPU.mass_conv;
+          }
+          gpv.reset();
+          gas_state(pid, T_gas_lo, T_gas_hi, u_gas, Y_gas, gpv);
+          gpv.define();
+          fdat->calcBoilT(gpv, cBoilT.data());
+          calculateSpraySource(dt, gpv, *fdat, p, cBoilT.data(), ltransparm);
+          return {gpv.fluid_mass_src, Long(gpv.num_sub), gpv.num_sub};
+        });
+      auto hv = reduce_data.value(reduce_op);
+      mass_src = amrex::get<0>(hv);
+      src_nsub = amrex::get<1>(hv);
+      src_max_sub = amrex::get<2>(hv);
+      t_src += ParallelDescriptor::second() - t0;
+    }
+
+    // Source deposition near a dense injector, with atomics against sorting
+    // the deposits by cell
+    const Box dep_box(
+      IntVect::TheZeroVector(),
+      IntVect(AMREX_D_DECL(dep_ncell - 1, dep_ncell - 1, dep_ncell - 1)));
+    const IntVect dep_len = dep_box.length();
+    FArrayBox src_atomic(dep_box, SprayDepComps::num);
+    FArrayBox src_sort(dep_box, SprayDepComps::num);
+    Array4<Real> const& sa = src_atomic.array();
+    Array4<Real> const& ss = src_sort.array();
+    Real t_atomic = 0.0;
+    Real t_sort = 0.0;
+    for (int rep = 0; rep < nrep; ++rep) {
+      src_atomic.setVal<RunOn::Device>(0.0);
+      src_sort.setVal<RunOn::Device>(0.0);
+      Gpu::streamSynchronize();
+      Real t0 = ParallelDescriptor::second();
+      ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        const IntVect iv =
+          injector_cell(pid, dep_dense_pct, dep_inj_cells, dep_len);
+        for (int c = 0; c < SprayDepComps::num; ++c) {
+          Gpu::Atomic::Add(&sa(iv, c), parcel_src(pid, c));
+        }
+      });
+      Gpu::streamSynchronize();
+      t_atomic += ParallelDescriptor::second() - t0;
+      t0 = ParallelDescriptor::second();
+      SprayDeposit spray_dep;
+      spray_dep.define(dep_box, nparcels);
+      const SprayDepositRecs dep_recs = spray_dep.recs();
+      ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        const IntVect iv =
+          injector_cell(pid, dep_dense_pct, dep_inj_cells, dep_len);
+        Real* dep = dep_recs.record(pid, iv);
+        for (int c = 0; c < SprayDepComps::num; ++c) {
+          dep[c] = parcel_src(pid, c);
+        }
+      });
+      spray_dep.deposit(
+        Array4<Real>(ss, SprayDepComps::mom, AMREX_SPACEDIM),
+        Array4<Real>(ss, SprayDepComps::mass, 1),
+        Array4<Real>(ss, SprayDepComps::spec, SPRAY_FUEL_NUM),
+        Array4<Real>(ss, SprayDepComps::eng, 1), true, true);
+      Gpu::streamSynchronize();
+      t_sort += ParallelDescriptor::second() - t0;
+    }
+    Real dep_diff = 0.0;
+    {
+      ReduceOps<ReduceOpMax> reduce_op;
+      ReduceData<Real> reduce_data(reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      reduce_op.eval(
+        dep_box, reduce_data,
+        [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple {
+          Real diff = 0.0;
+          for (int c = 0; c < SprayDepComps::num; ++c) {
+            diff = amrex::max(
+              diff, std::abs(ss(i, j, k, c) - sa(i, j, k, c)) /
+                      amrex::max(std::abs(sa(i, j, k, c)), 1.e-300));
+          }
+          return {diff};
+        });
+      dep_diff = amrex::get<0>(reduce_data.value(reduce_op));
+    }
+    if (dep_diff > 1.e-12) {
+      Abort("Sorted deposition differs from atomic deposition");
+    }
+
+    // Diameter statistics of the device samplers against the host
+    // distributions used for injection
+    Normal dist_normal;
+    dist_normal.init(0.5 * (dia_lo + dia_hi), 0.2 * (dia_hi - dia_lo));
+    LogNormal dist_lognormal;
+    dist_lognormal.init(0.5 * (dia_lo + dia_hi), 0.2 * (dia_hi - dia_lo));
+    Weibull dist_weibull;
+    dist_weibull.init(0.5 * (dia_lo + dia_hi), 3.);
+    ChiSquared dist_chisq;
+    dist_chisq.init(0.5 * (dia_lo + dia_hi));
+    const Vector<std::pair<std::string, DistBase*>> dists = {
+      {"Normal", &dist_normal},
+      {"LogNormal", &dist_lognormal},
+      {"Weibull", &dist_weibull},
+      {"ChiSquared", &dist_chisq}};
+    // The means and standard deviations of the host and device samples must
+    // agree within a few standard errors of their difference
+    const Real dist_nse = 5.0;
+    Vector<Array<Real, 4>> dist_stats;
+    Vector<Real> host_dia(nparcels);
+    for (const auto& dist : dists) {
+      const Real np = static_cast<Real>(nparcels);
+      Real host_mean = 0.0;
+      for (int n = 0; n < nparcels; ++n) {
+        host_dia[n] = dist.second->get_dia();
+        host_mean += host_dia[n];
+      }
+      host_mean /= np;
+      // Second and fourth central moments
+      Real host_m2 = 0.0;
+      Real host_m4 = 0.0;
+      for (int n = 0; n < nparcels; ++n) {
+        const Real d2 = (host_dia[n] - host_mean) * (host_dia[n] - host_mean);
+        host_m2 += d2;
+        host_m4 += d2 * d2;
+      }
+      host_m2 /= np;
+      host_m4 /= np;
+      DistData dd;
+      dist.second->get_dist_data(dd);
+      Gpu::DeviceVector<Real> dev_dia(nparcels);
+      Real* dia_ptr = dev_dia.data();
+      ParallelForRNG(
+        nparcels,
+        [=] AMREX_GPU_DEVICE(int n, RandomEngine const& engine) noexcept {
+          dia_ptr[n] = dd.get_dia(engine);
+        });
+      const Real dev_mean =
+        Reduce::Sum<Real>(
+          nparcels,
+          [=] AMREX_GPU_DEVICE(int n) -> Real { return dia_ptr[n]; }) /
+        np;
+      ReduceOps<ReduceOpSum, ReduceOpSum> reduce_op;
+      ReduceData<Real, Real> reduce_data(reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      reduce_op.eval(
+        nparcels, reduce_data, [=] AMREX_GPU_DEVICE(int n) -> ReduceTuple {
+          const Real d2 = (dia_ptr[n] - dev_mean) * (dia_ptr[n] - dev_mean);
+          return {d2, d2 * d2};
+        });
+      auto hv = reduce_data.value(reduce_op);
+      const Real dev_m2 = amrex::get<0>(hv) / np;
+      const Real dev_m4 = amrex::get<1>(hv) / np;
+      const Real host_std = std::sqrt(host_m2);
+      const Real dev_std = std::sqrt(dev_m2);
+      dist_stats.push_back({host_mean, host_std, dev_mean, dev_std});
+      // The variance of the sample variance is (m4 - m2^2) / n, and that of
+      // the sample standard deviation a quarter of it over m2
+      const Real se_mean = std::sqrt((host_m2 + dev_m2) / np);
+      const Real se_std = std::sqrt(
+        (amrex::max(host_m4 - host_m2 * host_m2, 0.0) /
+           amrex::max(host_m2, 1.e-300) +
+         amrex::max(dev_m4 - dev_m2 * dev_m2, 0.0) /
+           amrex::max(dev_m2, 1.e-300)) /
+        (4.0 * np));
+      if (
+        std::abs(dev_mean - host_mean) > dist_nse * se_mean ||
+        std::abs(dev_std - host_std) > dist_nse * se_std) {
+        Abort(
+          "Device diameter sampler differs from the host " + dist.first +
+          " distribution");
+      }
+    }
+
+    // Children of breakup and splashing, created on device: the children of
+    // each parent must carry the liquid mass the parent had before breakup,
+    // the splashed part of it for splashing, and for breakup into several
+    // children its momentum. The breakup data come from the parent parcels:
+    // TAB through splitDropletTAB, and KH-RT as in updateBreakupKHRT when the
+    // parent sheds all its mass into droplets of a quarter of its radius
+    SBVects refv;
+    refv.build(nparcels);
+    SBPtrs rf;
+    refv.fillPtrs_d(rf);
+    Gpu::DeviceVector<splash_breakup> N_SB_d(nparcels);
+    splash_breakup* N_SB = N_SB_d.data();
+    Gpu::DeviceVector<Real> parent_mass_d(nparcels);
+    Real* parent_mass = parent_mass_d.data();
+    const RealVect vel0(AMREX_D_DECL(u_gas, 0.2 * u_gas, -0.5 * u_gas));
+    Real rho_sb = 0.0;
+    for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+      rho_sb += 1.0 / (SPRAY_FUEL_NUM * fdat_h->rhoL(T_part, spf));
+    }
+    rho_sb = 1.0 / rho_sb;
+    const Real splash_frac = 0.4;
+    copy_parcels();
+    ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+      SprayParcel p = ptd[pid];
+      const Real dia_parent = p.rdata(SprayComps::pstateDia);
+      const Real num_dens_parent = static_cast<Real>(2 + pid % 64);
+      p.rdata(SprayComps::pstateNumDens) = num_dens_parent;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        p.rdata(SprayComps::pstateVel + dir) = vel0[dir];
+      }
+      parent_mass[pid] = num_dens_parent * M_PI / 6.0 * rho_sb *
+                         amrex::Math::powi<3>(dia_parent);
+      if (pid % 3 == 1) {
+        splitDropletTAB(pid, p, 1.0, N_SB, rf, 0.1 * u_gas);
+        return;
+      }
+      const bool splash = (pid % 3 == 2);
+      N_SB[pid] =
+        splash ? splash_breakup::splash_dry_splash : splash_breakup::breakup_KH;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        rf.loc[AMREX_SPACEDIM * pid + dir] = p.pos(dir);
+        rf.vel[AMREX_SPACEDIM * pid + dir] = vel0[dir];
+        // Wall normal for splashing, velocity direction for breakup
+        rf.norm[AMREX_SPACEDIM * pid + dir] =
+          splash ? ((dir == AMREX_SPACEDIM - 1) ? 1.0 : 0.0)
+                 : vel0[dir] / vel0.vectorLength();
+      }
+      rf.T0[pid] = p.rdata(SprayComps::pstateT);
+#if SPRAY_FUEL_NUM > 1
+      for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+        rf.Y0[SPRAY_FUEL_NUM * pid + spf] = p.rdata(SprayComps::pstateY + spf);
+      }
+#endif
+      if (splash) {
+        rf.ref_dia[pid] = dia_parent;
+        rf.num_dens[pid] = num_dens_parent;
+        rf.phi1[pid] = 100.0;
+        rf.phi2[pid] = splash_frac * parent_mass[pid] / num_dens_parent;
+        rf.phi3[pid] = (pid % 2 == 0) ? 0.0 : 0.05;
+      } else {
+        const Real rp = 0.5 * dia_parent;
+        const Real rs = 0.25 * rp;
+        rf.ref_dia[pid] = 2.0 * rs;
+        rf.num_dens[pid] = num_dens_parent * amrex::Math::powi<3>(rp / rs);
+        rf.phi1[pid] = 0.1 * u_gas;
+        rf.phi2[pid] = 0.0;
+        rf.phi3[pid] = 0.0;
+      }
+      p.id() = -1;
+    });
+    const Real ppp_fact = SprayParticleContainer::m_breakupPPPFact;
+    Gpu::DeviceVector<int> child_indx(nparcels);
+    int* cindx = child_indx.data();
+    Gpu::streamSynchronize();
+    Real t0_sb = ParallelDescriptor::second();
+    const int nchild = countSBChildren(nparcels, N_SB, rf, ppp_fact, cindx);
+    Gpu::DeviceVector<PType> child_parts(nchild);
+    Gpu::DeviceVector<ParticleReal> child_soa(
+      static_cast<Long>(NAR_SPR) * nchild);
+    Array<ParticleReal*, SprayComps::pstateNum> child_rdata = {{nullptr}};
+    for (int n = 0; n < NAR_SPR; ++n) {
+      child_rdata[n] = child_soa.data() + static_cast<Long>(n) * nchild;
+    }
+    const SprayTileData ctd(child_parts.data(), child_rdata.data());
+    fillSBChildren(
+      nparcels, N_SB, rf, cindx, dt, ppp_fact, fdat_h->do_breakup, fdat, ctd,
+      0, 1, 0);
+    Gpu::streamSynchronize();
+    const Real t_sb = ParallelDescriptor::second() - t0_sb;
+    Real sb_mass_err = 0.0;
+    Real sb_mom_err = 0.0;
+    {
+      ReduceOps<ReduceOpMax, ReduceOpMax> reduce_op;
+      ReduceData<Real, Real> reduce_data(reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      reduce_op.eval(
+        nparcels, reduce_data, [=] AMREX_GPU_DEVICE(int pid) -> ReduceTuple {
+          const Real num_dens0 = rf.num_dens[pid];
+          const int nc = numSBChildren(N_SB[pid], num_dens0, ppp_fact);
+          const bool splash = (N_SB[pid] >= splash_breakup::splash_dry_splash);
+          const Real mass0 =
+            splash ? splash_frac * parent_mass[pid] : parent_mass[pid];
+          Real mass = 0.0;
+          RealVect mom(AMREX_D_DECL(0.0, 0.0, 0.0));
+          for (int c = cindx[pid]; c < cindx[pid] + nc; ++c) {
+            SprayParcel p = ctd[c];
+            const Real cmass = p.rdata(SprayComps::pstateNumDens) * M_PI /
+                               6.0 * rho_sb *
+                               amrex::Math::powi<3>(
+                                 p.rdata(SprayComps::pstateDia));
+            mass += cmass;
+            for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+              mom[dir] += cmass * p.rdata(SprayComps::pstateVel + dir);
+            }
+          }
+          Real mom_err = 0.0;
+          // A single child, or an odd number in 2D, takes the breakup
+          // velocity alone
+          if (!splash && nc > 1 && (AMREX_SPACEDIM == 3 || nc % 2 == 0)) {
+            mom_err = (mom - mass0 * vel0).vectorLength() /
+                      (mass0 * vel0.vectorLength());
+          }
+          return {std::abs(mass - mass0) / mass0, mom_err};
+        });
+      auto hv = reduce_data.value(reduce_op);
+      sb_mass_err = amrex::get<0>(hv);
+      sb_mom_err = amrex::get<1>(hv);
+    }
+    if (sb_mass_err > 1.e-10 || sb_mom_err > 1.e-10) {
+      Abort("Breakup and splash children do not conserve mass or momentum");
+    }
+
+    // Parcel merging and splitting: pairs of parcels with different
+    // diameters, temperatures, and velocities are merged, and each merged
+    // parcel is split back into two, which must keep the liquid mass,
+    // momentum, and total energy of the parcels
+    copy_parcels();
+    ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+      SprayParcel p = ptd[pid];
+      p.rdata(SprayComps::pstateT) = T_part + static_cast<Real>(pid % 5);
+      p.rdata(SprayComps::pstateNumDens) = static_cast<Real>(1 + pid % 3);
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        p.rdata(SprayComps::pstateVel + dir) =
+          u_gas * static_cast<Real>((pid + dir) % 11) / 10.0;
+      }
+    });
+    // Liquid mass, momentum in each direction, and total energy of the first
+    // np parcels
+    using ParcelTotals = Array<Real, AMREX_SPACEDIM + 2>;
+    auto parcel_totals = [=](const int np) {
+      ReduceOps<
+        ReduceOpSum, AMREX_D_DECL(ReduceOpSum, ReduceOpSum, ReduceOpSum),
+        ReduceOpSum>
+        reduce_op;
+      ReduceData<Real, AMREX_D_DECL(Real, Real, Real), Real> reduce_data(
+        reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      reduce_op.eval(
+        np, reduce_data, [=] AMREX_GPU_DEVICE(int pid) -> ReduceTuple {
+          SprayParcel p = ptd[pid];
+          if (p.id() <= 0) {
+            return {0.0, AMREX_D_DECL(0.0, 0.0, 0.0), 0.0};
+          }
+          Real cp_part = 0.0;
+          const Real pmass = parcelMass(p, *fdat, cp_part);
+          RealVect mom;
+          Real ke = 0.0;
+          for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+            const Real u = p.rdata(SprayComps::pstateVel + dir);
+            mom[dir] = pmass * u;
+            ke += 0.5 * pmass * u * u;
+          }
+          return {
+            pmass, AMREX_D_DECL(mom[0], mom[1], mom[2]),
+            pmass * cp_part * p.rdata(SprayComps::pstateT) + ke};
+        });
+      auto hv = reduce_data.value(reduce_op);
+      return ParcelTotals{
+        amrex::get<0>(hv),
+        AMREX_D_DECL(amrex::get<1>(hv), amrex::get<2>(hv), amrex::get<3>(hv)),
+        amrex::get<AMREX_SPACEDIM + 1>(hv)};
+    };
+    // Largest relative change of the parcel totals, with each momentum
+    // component relative to the magnitude of the initial momentum
+    auto totals_err = [](const ParcelTotals& tot0, const ParcelTotals& tot1) {
+      Real mom0 = 0.0;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        mom0 += tot0[1 + dir] * tot0[1 + dir];
+      }
+      mom0 = std::sqrt(mom0);
+      Real err = std::abs(tot1[0] - tot0[0]) / tot0[0];
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        err = amrex::max(err, std::abs(tot1[1 + dir] - tot0[1 + dir]) / mom0);
+      }
+      const int ie = AMREX_SPACEDIM + 1;
+      return amrex::max(err, std::abs(tot1[ie] - tot0[ie]) / tot0[ie]);
+    };
+    const ParcelTotals tot0 = parcel_totals(nparcels);
+    const int do_breakup = fdat_h->do_breakup;
+    Gpu::streamSynchronize();
+    const Real t0_mrg = ParallelDescriptor::second();
+    ParallelFor(nparcels / 2, [=] AMREX_GPU_DEVICE(int n) noexcept {
+      mergeParcels(ptd[2 * n], ptd[2 * n + 1], *fdat, do_breakup);
+    });
+    Gpu::streamSynchronize();
+    const Real t_mrg = ParallelDescriptor::second() - t0_mrg;
+    const ParcelTotals tot1 = parcel_totals(nparcels);
+    // The copy of each merged parcel takes the slot of the parcel it absorbed
+    const RealVect split_plo(AMREX_D_DECL(0.0, 0.0, 0.0));
+    const RealVect split_dx(AMREX_D_DECL(1.0, 1.0, 1.0));
+    ParallelForRNG(
+      nparcels / 2,
+      [=] AMREX_GPU_DEVICE(int n, RandomEngine const& engine) noexcept {
+        splitParcel(
+          2 * n, 1, do_breakup, ptd, 2 * n + 1, nparcels + n + 1, 0,
+          split_plo, split_dx, engine);
+      });
+    const ParcelTotals tot2 = parcel_totals(nparcels);
+    const Real mrg_err = totals_err(tot0, tot1);
+    const Real split_err = totals_err(tot0, tot2);
+    if (mrg_err > 1.e-10 || split_err > 1.e-10) {
+      Abort("Merged or split parcels do not conserve mass, momentum or energy");
+    }
+
+    // Gas phase interpolation over the deposition box for interp_sub
+    // subcycles, gathering the conserved state of the stencil cells for every
+    // parcel and subcycle against interpolating the gas state cached once per
+    // cell. Both must give the same pressure at the parcels
+    constexpr int gas_eng = 1 + AMREX_SPACEDIM;
+    constexpr int gas_T = gas_eng + 1;
+    constexpr int gas_spec = gas_T + 1;
+    FArrayBox gas_fab(dep_box, gas_spec + NUM_SPECIES);
+    FArrayBox gas_cache(dep_box, SprayGasComps::num);
+    Array4<Real> const& ga = gas_fab.array();
+    Array4<Real> const& gca = gas_cache.array();
+    Array4<const Real> const rho_a(ga, 0, 1);
+    Array4<const Real> const mom_a(ga, 1, AMREX_SPACEDIM);
+    Array4<const Real> const eng_a(ga, gas_eng, 1);
+    Array4<const Real> const T_a(ga, gas_T, 1);
+    Array4<const Real> const rhoY_a(ga, gas_spec, NUM_SPECIES);
+    ParallelFor(dep_box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+      const IntVect iv(AMREX_D_DECL(i, j, k));
+      auto eos = pele::physics::PhysicsType::eos();
+      GasPhaseVals gpv;
+      gpv.reset();
+      gas_state(
+        static_cast<int>(dep_box.index(iv)), T_gas_lo, T_gas_hi, u_gas, Y_gas,
+        gpv);
+      Real e_gas = 0.0;
+      eos.TY2E(gpv.T_fluid, gpv.Y_fluid.data(), e_gas);
+      ga(iv, 0) = gpv.rho_fluid;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        ga(iv, 1 + dir) = gpv.rho_fluid * gpv.vel_fluid[dir];
+      }
+      ga(iv, gas_eng) =
+        gpv.rho_fluid * (e_gas + 0.5 * gpv.vel_fluid.radSquared());
+      ga(iv, gas_T) = gpv.T_fluid;
+      for (int n = 0; n < NUM_SPECIES; ++n) {
+        ga(iv, gas_spec + n) = gpv.rho_fluid * gpv.Y_fluid[n];
+      }
+    });
+    GpuArray<Real, NUM_SPECIES> gas_mw;
+    {
+      auto eos = pele::physics::PhysicsType::eos();
+      SprayUnits SPU;
+      eos.molecular_weight(gas_mw.data());
+      for (int n = 0; n < NUM_SPECIES; ++n) {
+        gas_mw[n] *= SPU.mass_conv;
+      }
+    }
+    // Stencil of parcel pid in subcycle sub, in cell units, moving across the
+    // box between subcycles
+    const Real interp_len = static_cast<Real>(dep_ncell - 1);
+    auto interp_stencil = [=] AMREX_GPU_DEVICE(
+                            const int pid, const int sub, IntVect* indx,
+                            Real* wts) noexcept {
+      RealVect lx;
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        const Real r = 0.618034 * static_cast<Real>((pid + 1) * (dir + 1)) +
+                       0.1 * static_cast<Real>(sub);
+        lx[dir] = 1.0 + interp_len * (r - std::floor(r));
+      }
+      trilinear_interp(
+        lx.floor(), lx, indx, wts, IntVect::TheZeroVector());
+    };
+    Gpu::DeviceVector<Real> p_direct_d(nparcels);
+    Gpu::DeviceVector<Real> p_cached_d(nparcels);
+    Real* p_direct = p_direct_d.data();
+    Real* p_cached = p_cached_d.data();
+    Real t_interp = 0.0;
+    Real t_cached = 0.0;
+    for (int rep = 0; rep < nrep; ++rep) {
+      Gpu::streamSynchronize();
+      Real t0 = ParallelDescriptor::second();
+      ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        GasPhaseVals gpv;
+        gpv.mw = gas_mw;
+        GpuArray<IntVect, AMREX_D_PICK(2, 4, 8)> indx_array;
+        GpuArray<Real, AMREX_D_PICK(2, 4, 8)> weights;
+        for (int sub = 0; sub < interp_sub; ++sub) {
+          interp_stencil(pid, sub, indx_array.data(), weights.data());
+          gpv.reset();
+          InterpolateGasPhase(
+            gpv, dep_box, rho_a, rhoY_a, T_a, mom_a, eng_a, indx_array.data(),
+            weights.data());
+          gpv.define();
+        }
+        p_direct[pid] = gpv.p_fluid;
+      });
+      Gpu::streamSynchronize();
+      t_interp += ParallelDescriptor::second() - t0;
+      t0 = ParallelDescriptor::second();
+      ParallelFor(
+        dep_box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+          CacheGasCell(
+            IntVect(AMREX_D_DECL(i, j, k)), gca, rho_a, rhoY_a, T_a, mom_a,
+            eng_a, gas_mw);
+        });
+      ParallelFor(nparcels, [=] AMREX_GPU_DEVICE(int pid) noexcept {
+        GasPhaseVals gpv;
+        gpv.mw = gas_mw;
+        GpuArray<IntVect, AMREX_D_PICK(2, 4, 8)> indx_array;
+        GpuArray<Real, AMREX_D_PICK(2, 4, 8)> weights;
+        for (int sub = 0; sub < interp_sub; ++sub) {
+          interp_stencil(pid, sub, indx_array.data(), weights.data());
+          gpv.reset();
+          InterpolateCachedGasPhase(
+            gpv, dep_box, gca, indx_array.data(), weights.data());
+          gpv.defineFromInvMW();
+        }
+        p_cached[pid] = gpv.p_fluid;
+      });
+      Gpu::streamSynchronize();
+      t_cached += ParallelDescriptor::second() - t0;
+    }
+    const Real interp_diff = Reduce::Max<Real>(
+      nparcels, [=] AMREX_GPU_DEVICE(int pid) -> Real {
+        return std::abs(p_cached[pid] - p_direct[pid]) / p_direct[pid];
+      });
+    if (interp_diff > 1.e-10) {
+      Abort("Cached gas phase interpolation differs from direct interpolation");
+    }
+
+    // Parcel update of a spray container on a periodic mesh, with cont_cfl
+    // subcycles at most, depositing the gas phase sources with atomics
+    // against sort_deposit: sorted deposits on GPU, private source tiles on
+    // CPU. Both must deposit the same sources
+    int cont_ncell = 16;
+    pp.query("cont_ncell", cont_ncell);
+    int cont_max_grid_size = 8;
+    pp.query("cont_max_grid_size", cont_max_grid_size);
+    int cont_nparcels = 20000;
+    pp.query("cont_nparcels", cont_nparcels);
+    Real cont_cfl = 1.5;
+    pp.query("cont_cfl", cont_cfl);
+    const Real cont_len = 0.1;
+    const RealBox cont_rb(
+      {AMREX_D_DECL(0.0, 0.0, 0.0)},
+      {AMREX_D_DECL(cont_len, cont_len, cont_len)});
+    SprayEvalMesh mesh(cont_rb, cont_ncell, cont_max_grid_size);
+    BCRec phys_bc;
+    for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+      phys_bc.setLo(dir, PhysBCType::interior);
+      phys_bc.setHi(dir, PhysBCType::interior);
+    }
+    SprayComps scomps;
+    scomps.rhoIndx = EvalGasComps::rho;
+    scomps.momIndx = EvalGasComps::mom;
+    scomps.engIndx = EvalGasComps::eng;
+    scomps.utempIndx = EvalGasComps::T;
+    scomps.specIndx = EvalGasComps::spec;
+    scomps.rhoSrcIndx = SprayDepComps::mass;
+    scomps.momSrcIndx = SprayDepComps::mom;
+    scomps.engSrcIndx = SprayDepComps::eng;
+    scomps.specSrcIndx = SprayDepComps::spec;
+    SprayParticleContainer::AssignSprayComps(scomps);
+    const int state_ghosts =
+      SprayParticleContainer::getStateGhostCells(0, 0, 1, cont_cfl);
+    const int source_ghosts =
+      SprayParticleContainer::getSourceGhostCells(0, 0, 1, cont_cfl);
+    MultiFab cont_state(
+      mesh.boxArray(0), mesh.DistributionMap(0), EvalGasComps::num,
+      state_ghosts);
+    fill_gas_state(cont_state, mesh.Geom(0), T_gas_lo, T_gas_hi, u_gas, Y_gas);
+    // Parcels move by up to cont_cfl cells in each direction
+    const Real cont_dt = cont_cfl * mesh.Geom(0).CellSize(0) / u_gas;
+    EvalParcels cont_parcels;
+    cont_parcels.dense_pct = dep_dense_pct;
+    cont_parcels.inj_cells = dep_inj_cells;
+    cont_parcels.T_part = T_part;
+    cont_parcels.dia_lo = dia_lo;
+    cont_parcels.dia_hi = dia_hi;
+    cont_parcels.u_max = u_gas;
+    const bool sort_deposit = SprayParticleContainer::m_sortDeposit;
+    Array<MultiFab, 2> cont_src;
+    for (int sort = 0; sort < 2; ++sort) {
+      cont_src[sort].define(
+        mesh.boxArray(0), mesh.DistributionMap(0), SprayDepComps::num,
+        source_ghosts);
+      cont_src[sort].setVal(0.0);
+      SprayParticleContainer pc(&mesh, &phys_bc);
+      add_eval_parcels(pc, cont_nparcels, cont_parcels);
+      SprayParticleContainer::m_sortDeposit = (sort == 1);
+      pc.updateParticles(
+        0, cont_state, cont_src[sort], cont_dt, 0.0, state_ghosts,
+        source_ghosts, false, false, true, ltransparm, cont_cfl);
+    }
+    SprayParticleContainer::m_sortDeposit = sort_deposit;
+    MultiFab::Subtract(
+      cont_src[1], cont_src[0], 0, 0, SprayDepComps::num, source_ghosts);
+    Real cont_dep_diff = 0.0;
+    for (int c = 0; c < SprayDepComps::num; ++c) {
+      const Real src_max =
+        amrex::max(cont_src[0].norm0(c, source_ghosts), 1.e-300);
+      cont_dep_diff = amrex::max(
+        cont_dep_diff, cont_src[1].norm0(c, source_ghosts) / src_max);
+    }
+    if (cont_dep_diff > 1.e-10) {
+      Abort("Parcel update deposits differ with sort_deposit");
+    }
+
+    // Injection of a jet with device_injection, with the diameters of the
+    // Normal distribution of spray.mean_dia and spray.std_dev: the parcels
+    // must carry the mass to inject, which they exceed by less than the mass
+    // of one parcel, and be stored in the tiles of the cells they are in
+    int inj_nparcels = 10000;
+    pp.query("inj_nparcels", inj_nparcels);
+    const bool device_inject = SprayParticleContainer::m_deviceInject;
+    SprayParticleContainer::m_deviceInject = true;
+    SprayParticleContainer inj_pc(&mesh, &phys_bc);
+    GpuArray<Real, SPRAY_FUEL_NUM> jet_Y;
+    for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+      jet_Y[spf] = 1.0 / SPRAY_FUEL_NUM;
+    }
+    const RealVect jet_cent(
+      AMREX_D_DECL(0.5 * cont_len, 0.5 * cont_len, 0.5 * cont_len));
+    const RealVect jet_norm(AMREX_D_DECL(1.0, 0.0, 0.0));
+    SprayJet jet(
+      "eval_jet", mesh.Geom(0), jet_cent, jet_norm, 20.0, 0.2 * cont_len,
+      u_gas, 0.0, T_part, jet_Y, "Normal");
+    // Parcels of the mean diameter carry 1 / inj_nparcels of the mass
+    jet.set_mass_flow(
+      inj_nparcels * M_PI / 6.0 * rho_sb *
+      amrex::Math::powi<3>(jet.get_avg_dia()) / cont_dt);
+    jet.set_num_ppp(1.0);
+    const Real inject_mass = jet.mass_flow_rate(0.0) * cont_dt;
+    inj_pc.sprayInjection(0.0, &jet, cont_dt, 0);
+    SprayParticleContainer::m_deviceInject = device_inject;
+    Real inj_mass = jet.m_totalInjMass;
+    Long inj_np = 0;
+    Long inj_misplaced = 0;
+    Real inj_pmass = 0.0;
+    Real inj_pmass_max = 0.0;
+    {
+      ReduceOps<ReduceOpSum, ReduceOpSum, ReduceOpSum, ReduceOpMax> reduce_op;
+      ReduceData<Long, Long, Real, Real> reduce_data(reduce_op);
+      using ReduceTuple = typename decltype(reduce_data)::Type;
+      const auto plo = mesh.Geom(0).ProbLoArray();
+      const auto dxi = mesh.Geom(0).InvCellSizeArray();
+      const bool tiling = SprayParticleContainer::do_tiling;
+      const IntVect tsize = SprayParticleContainer::tile_size;
+      // The injection stores the parcels in the tiles of any grid, which
+      // Redistribute sends to their ranks
+      for (auto& kv : inj_pc.GetParticles(0)) {
+        const Box gbx = mesh.boxArray(0)[kv.first.first];
+        const int tile = kv.first.second;
+        const SprayTileData ptd(kv.second);
+        reduce_op.eval(
+          static_cast<int>(kv.second.numParticles()), reduce_data,
+          [=] AMREX_GPU_DEVICE(int pid) -> ReduceTuple {
+            SprayParcel p = ptd[pid];
+            IntVect iv;
+            for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+              iv[dir] = static_cast<int>(
+                amrex::Math::floor((p.pos(dir) - plo[dir]) * dxi[dir]));
+            }
+            Box tbx;
+            const bool in_tile =
+              gbx.contains(iv) &&
+              getTileIndex(iv, gbx, tiling, tsize, tbx) == tile;
+            const Real pmass = p.rdata(SprayComps::pstateNumDens) * M_PI /
+                               6.0 * rho_sb *
+                               amrex::Math::powi<3>(
+                                 p.rdata(SprayComps::pstateDia));
+            return {Long(1), Long(in_tile ? 0 : 1), pmass, pmass};
+          });
+      }
+      auto hv = reduce_data.value(reduce_op);
+      inj_np = amrex::get<0>(hv);
+      inj_misplaced = amrex::get<1>(hv);
+      inj_pmass = amrex::get<2>(hv);
+      inj_pmass_max = amrex::get<3>(hv);
+    }
+    ParallelDescriptor::ReduceLongSum(inj_np);
+    ParallelDescriptor::ReduceLongSum(inj_misplaced);
+    ParallelDescriptor::ReduceRealSum(inj_pmass);
+    ParallelDescriptor::ReduceRealSum(inj_mass);
+    ParallelDescriptor::ReduceRealMax(inj_pmass_max);
+    if (inj_np == 0 || inj_misplaced > 0) {
+      Abort("Parcels injected on device are missing or in the wrong tiles");
+    }
+    if (
+      inj_mass < inject_mass || inj_mass - inject_mass > inj_pmass_max ||
+      std::abs(inj_pmass - inj_mass) > 1.e-10 * inj_mass) {
+      Abort("Parcels injected on device do not carry the injection mass");
+    }
+
+    // Binary parcel files and sampling planes of a spray container, read back
+    // in io_dir. All the parcels are written with a binary fraction of one,
+    // and the same parcels before and after an update with io_frac. The
+    // sampling planes hold the parcels crossing them during the update, at
+    // the time and position where their path crosses the plane
+    std::string io_dir = "spray_eval_io";
+    pp.query("io_dir", io_dir);
+    Real io_frac = 0.5;
+    pp.query("io_frac", io_frac);
+    const Real binary_frac = SprayParticleContainer::m_binaryFrac;
+    const Vector<std::string> plane_names =
+      SprayParticleContainer::m_planeNames;
+    const Vector<SprayPlane> sample_planes =
+      SprayParticleContainer::m_samplePlanes;
+    const Geometry& io_geom = mesh.Geom(0);
+    const Real io_dx = io_geom.CellSize(0);
+    SprayPlane plane_x;
+    plane_x.point = RealVect(AMREX_D_DECL(2.0 * io_dx, 0.0, 0.0));
+    plane_x.normal = RealVect(AMREX_D_DECL(1.0, 0.0, 0.0));
+    SprayPlane plane_xy;
+    plane_xy.point = RealVect(AMREX_D_DECL(2.0 * io_dx, io_dx, 0.0));
+    plane_xy.normal = RealVect(AMREX_D_DECL(1.0, 1.0, 0.0));
+    plane_xy.normal /= plane_xy.normal.vectorLength();
+    SprayParticleContainer::m_planeNames = {"eval_x", "eval_xy"};
+    SprayParticleContainer::m_samplePlanes = {plane_x, plane_xy};
+    SprayParticleContainer io_pc(&mesh, &phys_bc);
+    add_eval_parcels(io_pc, cont_nparcels, cont_parcels);
+    const Vector<std::string> comp_names =
+      SprayParticleContainer::sprayCompNames();
+    Vector<std::string> pos_names = {AMREX_D_DECL("x", "y", "z")};
+    Vector<PType> io_parts(cont_nparcels);
+    Vector<Real> io_vals(
+      static_cast<Long>(cont_nparcels) * SprayComps::pstateNum);
+    for (int pid = 0; pid < cont_nparcels; ++pid) {
+      cont_parcels.make(
+        pid, io_geom, io_parts[pid],
+        io_vals.data() + static_cast<Long>(pid) * SprayComps::pstateNum);
+    }
+    Long io_nfrac = 0;
+    {
+      SprayParticleContainer::m_binaryFrac = 1.0;
+      io_pc.writeBinaryParticles(io_dir + "/all");
+      const BinaryColumns cols =
+        read_binary_columns(io_dir + "/all/spray_binary");
+      if (cols.count != cont_nparcels) {
+        Abort("Binary spray files do not hold all the parcels");
+      }
+      Vector<int> found(cont_nparcels, 0);
+      Real maxdiff = 0.0;
+      for (Long r = 0; r < cols.count; ++r) {
+        const Long id = cols.ints.at("id")[r];
+        if (id < 1 || id > cont_nparcels || found[id - 1] != 0) {
+          Abort("Binary spray files hold a wrong or repeated parcel id");
+        }
+        found[id - 1] = 1;
+        const Real* pvals =
+          io_vals.data() + (id - 1) * SprayComps::pstateNum;
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          maxdiff = amrex::max(
+            maxdiff, std::abs(
+                       cols.reals.at(pos_names[dir])[r] -
+                       io_parts[id - 1].pos(dir)));
+        }
+        for (int n = 0; n < SprayComps::pstateNum; ++n) {
+          maxdiff = amrex::max(
+            maxdiff, std::abs(cols.reals.at(comp_names[n])[r] - pvals[n]));
+        }
+      }
+      if (maxdiff > 0.0) {
+        Abort("Binary spray files differ from the parcels written");
+      }
+    }
+    // Ids of the parcels written with io_frac
+    auto frac_ids = [&](const std::string& dir) {
+      SprayParticleContainer::m_binaryFrac = io_frac;
+      io_pc.writeBinaryParticles(dir);
+      Vector<Long> ids =
+        read_binary_columns(dir + "/spray_binary").ints.at("id");
+      std::sort(ids.begin(), ids.end());
+      return ids;
+    };
+    const Vector<Long> frac_ids0 = frac_ids(io_dir + "/frac0");
+    io_nfrac = static_cast<Long>(frac_ids0.size());
+    if (io_frac < 1.0 && (io_nfrac == 0 || io_nfrac == cont_nparcels)) {
+      Abort("Binary fraction does not select a part of the parcels");
+    }
+    // Update moving the parcels, recording the sampling planes they cross
+    MultiFab io_src(
+      mesh.boxArray(0), mesh.DistributionMap(0), SprayDepComps::num,
+      source_ghosts);
+    io_src.setVal(0.0);
+    io_pc.updateParticles(
+      0, cont_state, io_src, cont_dt, 0.0, state_ghosts, source_ghosts, false,
+      false, true, ltransparm, cont_cfl);
+    // Positions and spray components of the parcels after the update, before
+    // Redistribute moves them back into the periodic domain
+    const int io_ncomp = AMREX_SPACEDIM + SprayComps::pstateNum;
+    const Vector<Real> io_final_h = parcel_values_by_id(io_pc, cont_nparcels);
+    io_pc.writeSamplePlanes(io_dir);
+    Long io_nplane = 0;
+    for (int pl = 0; pl < 2; ++pl) {
+      const SprayPlane& plane = SprayParticleContainer::m_samplePlanes[pl];
+      // Records expected from the path of each parcel, as time, position,
+      // velocity, diameter, temperature, mass fractions and number density
+      Vector<Vector<Real>> expected;
+      for (int pid = 0; pid < cont_nparcels; ++pid) {
+        const Real* v = io_final_h.data() + static_cast<Long>(pid) * io_ncomp;
+        const RealVect x0 = io_parts[pid].pos();
+        const RealVect x1(AMREX_D_DECL(v[0], v[1], v[2]));
+        Real s_cross = 0.0;
+        if (!plane.crossed(x0, x1, s_cross)) {
+          continue;
+        }
+        Vector<Real> rec = {s_cross * cont_dt};
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          rec.push_back(x0[dir] + s_cross * (x1[dir] - x0[dir]));
+        }
+        for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+          rec.push_back(v[AMREX_SPACEDIM + SprayComps::pstateVel + dir]);
+        }
+        rec.push_back(v[AMREX_SPACEDIM + SprayComps::pstateDia]);
+        rec.push_back(v[AMREX_SPACEDIM + SprayComps::pstateT]);
+        for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+          rec.push_back(v[AMREX_SPACEDIM + SprayComps::pstateY + spf]);
+        }
+        rec.push_back(v[AMREX_SPACEDIM + SprayComps::pstateNumDens]);
+        expected.push_back(rec);
+      }
+      const BinaryColumns cols = read_binary_columns(
+        io_dir + "/spray_planes/" + SprayParticleContainer::m_planeNames[pl]);
+      if (cols.count != static_cast<Long>(expected.size())) {
+        Abort("Sampling plane does not hold the parcels crossing it");
+      }
+      Vector<std::string> rec_names = {"time"};
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        rec_names.push_back(pos_names[dir]);
+      }
+      for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) {
+        rec_names.push_back(comp_names[SprayComps::pstateVel + dir]);
+      }
+      rec_names.push_back(comp_names[SprayComps::pstateDia]);
+      rec_names.push_back(comp_names[SprayComps::pstateT]);
+      for (int spf = 0; spf < SPRAY_FUEL_NUM; ++spf) {
+        rec_names.push_back(comp_names[SprayComps::pstateY + spf]);
+      }
+      rec_names.push_back(comp_names[SprayComps::pstateNumDens]);
+      Vector<Vector<Real>> written(cols.count);
+      for (Long r = 0; r < cols.count; ++r) {
+        for (const auto& name : rec_names) {
+          written[r].push_back(cols.reals.at(name)[r]);
+        }
+        const RealVect xr(
+          AMREX_D_DECL(written[r][1], written[r][2], written[r][3]));
+        if (std::abs(plane.dist(xr)) > 1.e-12 * cont_len) {
+          Abort("Sampling plane record is not on the plane");
+        }
+      }
+      // Records of different parcels cross the plane at different times
+      std::sort(expected.begin(), expected.end());
+      std::sort(written.begin(), written.end());
+      for (int c = 0; c < static_cast<int>(rec_names.size()); ++c) {
+        Real scale = 1.e-300;
+        for (const auto& rec : expected) {
+          scale = amrex::max(scale, std::abs(rec[c]));
+        }
+        for (Long r = 0; r < cols.count; ++r) {
+          if (std::abs(written[r][c] - expected[r][c]) > 1.e-12 * scale) {
+            Abort(
+              "Sampling plane " + rec_names[c] +
+              " differs from the path of the parcels");
+          }
+        }
+      }
+      io_nplane += cols.count;
+    }
+    io_pc.Redistribute();
+    if (frac_ids(io_dir + "/frac1") != frac_ids0) {
+      Abort("Binary fraction selects different parcels after an update");
+    }
+    SprayParticleContainer::m_binaryFrac = binary_frac;
+    SprayParticleContainer::m_planeNames = plane_names;
+    SprayParticleContainer::m_samplePlanes = sample_planes;
+
+    // Checkpoints: with chk_write, the parcels of the spray container, with
+    // sub_dt set, are written to chk_write, and to chk_write_nosub as written
+    // before the sub_dt component was added. With chk_restart, the parcels
+    // restarted from both must be the ones written. The particle files do not
+    // depend on the parcel layout, so either layout restarts from the other
+    std::string chk_write;
+    pp.query("chk_write", chk_write);
+    std::string chk_restart;
+    pp.query("chk_restart", chk_restart);
+    if (!chk_write.empty()) {
+      SprayParticleContainer chk_pc(&mesh, &phys_bc);
+      add_eval_parcels(chk_pc, cont_nparcels, cont_parcels);
+      for (MyParIter pti(chk_pc, 0); pti.isValid(); ++pti) {
+        const SprayTileData ptd(pti.GetParticleTile());
+        ParallelFor(
+          pti.numParticles(), [=] AMREX_GPU_DEVICE(Long pid) noexcept {
+            SprayParcel p = ptd[pid];
+            p.rdata(SprayComps::pstateDtSub) = chk_sub_dt(p.id());
+          });
+      }
+      Gpu::streamSynchronize();
+      chk_pc.SprayParticleIO(0, true, chk_write);
+      write_checkpoint_without_sub_dt(chk_pc, chk_write + "_nosub");
+    }
+    Real chk_diff = 0.0;
+    if (!chk_restart.empty()) {
+      const int chk_ncomp = AMREX_SPACEDIM + SprayComps::pstateNum;
+      for (int nosub = 0; nosub < 2; ++nosub) {
+        const std::string dir =
+          (nosub == 1) ? chk_restart + "_nosub" : chk_restart;
+        if (SprayParticleContainer::checkRestartComps(dir) != (nosub == 1)) {
+          Abort("Spray checkpoint " + dir + " has unexpected components");
+        }
+        SprayParticleContainer chk_pc(&mesh, &phys_bc);
+        chk_pc.SprayInitialize(dir);
+        if (chk_pc.TotalNumberOfParticles() != cont_nparcels) {
+          Abort("Spray checkpoint " + dir + " restarted the wrong parcels");
+        }
+        const Vector<Real> chk_vals =
+          parcel_values_by_id(chk_pc, cont_nparcels);
+        for (int pid = 0; pid < cont_nparcels; ++pid) {
+          PType p0;
+          Real pvals[SprayComps::pstateNum];
+          cont_parcels.make(pid, mesh.Geom(0), p0, pvals);
+          pvals[SprayComps::pstateDtSub] =
+            (nosub == 1) ? 0.0 : chk_sub_dt(pid + 1);
+          const Real* v = chk_vals.data() + static_cast<Long>(pid) * chk_ncomp;
+          for (int n = 0; n < chk_ncomp; ++n) {
+            const Real ref =
+              (n < AMREX_SPACEDIM) ? p0.pos(n) : pvals[n - AMREX_SPACEDIM];
+            chk_diff = amrex::max(
+              chk_diff,
+              std::abs(v[n] - ref) / amrex::max(std::abs(ref), 1.e-30));
+          }
+        }
+      }
+      if (chk_diff > 1.e-12) {
+        Abort("Spray parcels differ after a restart");
+      }
+    }
+
+    const Real nevals = static_cast<Real>(nparcels) * nrep;
+    Print() << " " << nparcels << " parcels, " << nrep << " repetitions, "
+            << NUM_SPECIES << " gas species, " << SPRAY_FUEL_NUM
+            << " fuel species\n";
+#ifdef PELE_SPRAY_SOA
+    Print() << " parcel components in struct-of-arrays, ";
+#else
+    Print() << " parcel components in particle struct, ";
+#endif
+    Print() << sizeof(PType) + NAR_SPR * sizeof(ParticleReal)
+            << " bytes per parcel\n";
+    Print() << "   skin transport, all diffusivities:  " << nevals / t_full
+            << " parcels/s\n";
+    Print() << "   skin transport, fuel diffusivities: " << nevals / t_fuel
+            << " parcels/s (speedup " << t_full / t_fuel << ")\n";
+    Print() << "   max relative difference:            " << maxdiff << "\n";
+    Print() << "   parcel update:                      " << nevals / t_upd
+            << " parcels/s\n";
+    Print() << "   evaporation kernel:                 " << nevals / t_src
+            << " parcels/s\n";
+    Print() << "   gas phase mass source:              " << mass_src << "\n";
+    Print() << "   evaporation substeps per parcel:    "
+            << static_cast<Real>(src_nsub) / nparcels << " (max "
+            << src_max_sub << ")\n";
+    Print() << " deposition in " << dep_box.numPts() << " cells, "
+            << dep_dense_pct << "% of the parcels in " << dep_inj_cells
+            << " injector cells\n";
+    Print() << "   atomic deposition:                  " << nevals / t_atomic
+            << " parcels/s\n";
+    Print() << "   sorted deposition:                  " << nevals / t_sort
+            << " parcels/s (speedup " << t_atomic / t_sort << ")\n";
+    Print() << "   max relative difference:            " << dep_diff << "\n";
+    Print() << " breakup and splash, " << nchild << " children of "
+            << nparcels << " parents\n";
+    Print() << "   child creation:                     " << nparcels / t_sb
+            << " parents/s\n";
+    Print() << "   max relative mass error:            " << sb_mass_err << "\n";
+    Print() << "   max relative momentum error:        " << sb_mom_err << "\n";
+    Print() << " parcel merging and splitting, " << nparcels / 2
+            << " pairs\n";
+    Print() << "   parcel merging:                     "
+            << (nparcels / 2) / t_mrg << " pairs/s\n";
+    Print() << "   max relative error after merging:   " << mrg_err << "\n";
+    Print() << "   max relative error after splitting: " << split_err << "\n";
+    Print() << " gas phase interpolation, " << interp_sub
+            << " subcycles per parcel\n";
+    Print() << "   direct interpolation:               "
+            << nevals * interp_sub / t_interp << " interpolations/s\n";
+    Print() << "   cached interpolation:               "
+            << nevals * interp_sub / t_cached << " interpolations/s\n";
+    Print() << "   max relative pressure difference:   " << interp_diff
+            << "\n";
+    Print() << " spray container, " << cont_nparcels << " parcels in "
+            << mesh.boxArray(0).size() << " boxes of " << mesh.Geom(0).Domain()
+            << ", " << cont_cfl << " cells per update\n";
+    Print() << "   max relative difference of the deposits with and without "
+               "sort_deposit: "
+            << cont_dep_diff << "\n";
+    Print() << " device injection, " << inj_np << " parcels\n";
+    Print() << "   mass to inject:                     " << inject_mass
+            << "\n";
+    Print() << "   injected mass:                      " << inj_mass
+            << " (parcels " << inj_pmass << ")\n";
+    Print() << " binary files and sampling planes in " << io_dir << "\n";
+    Print() << "   parcels written with a binary fraction of " << io_frac
+            << ": " << io_nfrac << "\n";
+    Print() << "   sampling plane records:             " << io_nplane
+            << "\n";
+    if (!chk_write.empty()) {
+      Print() << " checkpoints written to " << chk_write << " and "
+              << chk_write << "_nosub\n";
+    }
+    if (!chk_restart.empty()) {
+      Print() << " restarted from " << chk_restart << " and " << chk_restart
+              << "_nosub\n";
+      Print() << "   max relative difference:            " << chk_diff
+              << "\n";
+    }
+    Print() << " injection diameters, host and device samplers (mean, std)\n";
+    for (int n = 0; n < static_cast<int>(dists.size()); ++n) {
+      Print() << "   " << dists[n].first << ": host (" << dist_stats[n][0]
+              << ", " << dist_stats[n][1] << "), device (" << dist_stats[n][2]
+              << ", " << dist_stats[n][3] << ")\n";
+    }
+  }
+  Finalize();
+
+  return 0;
+}
@@ -29,6 +29,8 @@ main(int argc, char* argv[])
 #ifdef USE_MANIFOLD_EOS
     trans_parms.host_only_parm().manfunc_par =
       eos_parms.host_only_parm().manfunc_par;
+    trans_parms.host_only_parm().manfunc_batch =
+      eos_parms.host_only_parm().manfunc_batch;
 #endif
     trans_parms.initialize();
 
@@ -123,6 +125,41 @@ main(int argc, char* argv[])
       });
     }
 
+#ifdef USE_MANIFOLD_TRANSPORT
+    {
+      // The batched evaluation of the manifold transport coefficients must
+      // match the per-cell path
+      amrex::MultiFab D_batch(ba, dm, NUM_SPECIES, num_grow);
+      amrex::MultiFab mu_batch(ba, dm, 1, num_grow);
+      amrex::MultiFab xi_batch(ba, dm, 1, num_grow);
+      amrex::MultiFab lam_batch(ba, dm, 1, num_grow);
+      amrex::MultiFab chi_batch(ba, dm, NUM_SPECIES, num_grow);
+      const auto& manfunc_batch = *trans_parms.host_only_parm().manfunc_batch;
+      for (amrex::MFIter mfi(mass_frac, amrex::TilingIfNotGPU());
+           mfi.isValid(); ++mfi) {
+        pele::physics::transport::ManifoldTransport::get_transport_coeffs_batch(
+          mfi.tilebox(), mass_frac.const_array(mfi),
+          temperature.const_array(mfi), density.const_array(mfi),
+          D_batch.array(mfi), chi_batch.array(mfi), mu_batch.array(mfi),
+          xi_batch.array(mfi), lam_batch.array(mfi), trans_parms.host_parm(),
+          manfunc_batch);
+      }
+
+      amrex::Real ref = amrex::max(mu.norm0(0), D.norm0(0));
+      amrex::MultiFab::Subtract(D_batch, D, 0, 0, NUM_SPECIES, 0);
+      amrex::MultiFab::Subtract(mu_batch, mu, 0, 0, 1, 0);
+      amrex::Real maxdiff = mu_batch.norm0(0);
+      for (int n = 0; n < NUM_SPECIES; ++n) {
+        maxdiff = amrex::max(maxdiff, D_batch.norm0(n));
+      }
+      amrex::Print() << " Max relative difference batched vs per-cell: "
+                     << maxdiff / ref << std::endl;
+      if (maxdiff > 1.e-10 * ref) {
+        amrex::Abort("Batched manifold transport does not match per-cell");
+      }
+    }
+#endif
+
     trans_parms.deallocate();
     eos_parms.deallocate();
 
@@ -0,0 +1,145 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include <AMReX_FArrayBox.H>
+#include <AMReX_Geometry.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+#include <AMReX_Utility.H>
+
+#include <turbinflow.H>
+
+using namespace amrex;
+
+// Write a smooth periodic velocity field in the TurbInflow file format (see
+// Support/TurbFileHIT): one z-plane FAB per component and plane, with one
+// periodic ghost point on each side in the transverse directions
+void
+write_turb_file(const std::string& a_dir, const int a_ncell)
+{
+  if (!ParallelDescriptor::IOProcessor()) {
+    return;
+  }
+  if (!UtilCreateDirectory(a_dir, 0755)) {
+    CreateDirectoryFailed(a_dir);
+  }
+  const Real L = 2.0 * M_PI;
+  const Real dx = L / a_ncell;
+  const int nx = a_ncell + 3;
+  const int nz = a_ncell + 1;
+
+  std::ofstream hdr((a_dir + "/HDR").c_str(), std::ios::out | std::ios::trunc);
+  std::ofstream dat(
+    (a_dir + "/DAT").c_str(),
+    std::ios::out | std::ios::trunc | std::ios::binary);
+  hdr << nx << ' ' << nx << ' ' << nz << '\n';
+  hdr << L + 2.0 * dx << ' ' << L + 2.0 * dx << ' ' << L << '\n';
+  hdr << "1 1 1\n";
+  for (int n = 0; n < AMREX_SPACEDIM; ++n) {
+    for (int kp = 0; kp < nz; ++kp) {
+      hdr << dat.tellp() << '\n';
+      const Box bx(IntVect(0, 0, kp), IntVect(nx - 1, nx - 1, kp));
+      FArrayBox fab(bx, 1, The_Pinned_Arena());
+      auto const& a = fab.array();
+      LoopOnCpu(bx, [&](int i, int j, int k) noexcept {
+        const Real x = (i - 1) * dx;
+        const Real y = (j - 1) * dx;
+        const Real z = k * dx;
+        a(i, j, k) = std::sin(x + n) * std::cos(2.0 * y - n) *
+                     std::sin(z + 0.3 * n);
+      });
+      fab.writeOn(dat);
+    }
+  }
+}
+
+int
+main(int argc, char* argv[])
+{
+  Initialize(argc, argv);
+  {
+    BL_PROFILE("main::main()");
+
+    ParmParse pp;
+    int n_cell = 32;
+    pp.query("n_cell", n_cell);
+    int turb_ncell = 64;
+    pp.query("turb_ncell", turb_ncell);
+    int nsteps = 300;
+    pp.query("nsteps", nsteps);
+    Real dt = 0.005;
+    pp.query("dt", dt);
+    Real work_time = 0.002;
+    pp.query("work_time", work_time);
+
+    // Both inflows read the same file
+    std::string turb_file;
+    ParmParse("turbinflow.sync").get("turb_file", turb_file);
+    write_turb_file(turb_file, turb_ncell);
+    ParallelDescriptor::Barrier();
+
+    const Box domain(IntVect(0), IntVect(n_cell - 1));
+    const RealBox rb(
+      {AMREX_D_DECL(0.0, 0.0, 0.0)}, {AMREX_D_DECL(1.0, 1.0, 1.0)});
+    const Geometry geom(
+      domain, rb, 0, Array<int, AMREX_SPACEDIM>{AMREX_D_DECL(1, 0, 1)});
+
+    pele::physics::turbinflow::TurbInflow turb;
+    turb.init(geom);
+
+    // Boundary planes of the y faces
+    const int dir = 1;
+    Box lo_bx(domain);
+    lo_bx.setRange(dir, -1);
+    Box hi_bx(domain);
+    hi_bx.setRange(dir, n_cell);
+    FArrayBox lo_data(lo_bx, AMREX_SPACEDIM, The_Pinned_Arena());
+    FArrayBox hi_data(hi_bx, AMREX_SPACEDIM, The_Pinned_Arena());
+
+    Real t_sync = 0.0;
+    Real t_prefetch = 0.0;
+    Real t_work = 0.0;
+    Real maxdiff = 0.0;
+    for (int step = 0; step < nsteps; ++step) {
+      const Real time = step * dt;
+      Real t0 = ParallelDescriptor::second();
+      turb.add_turb(domain, lo_data, 0, geom, time, dir, Orientation::low);
+      const Real t1 = ParallelDescriptor::second();
+      turb.add_turb(domain, hi_data, 0, geom, time, dir, Orientation::high);
+      const Real t2 = ParallelDescriptor::second();
+      t_sync += t1 - t0;
+      t_prefetch += t2 - t1;
+      Gpu::streamSynchronize();
+
+      // Velocities are flipped on the high side
+      auto const& lo = lo_data.const_array();
+      auto const& hi = hi_data.const_array();
+      for (int n = 0; n < AMREX_SPACEDIM; ++n) {
+        LoopOnCpu(lo_bx, [&](int i, int /*j*/, int k) noexcept {
+          maxdiff = amrex::max(
+            maxdiff, std::abs(lo(i, -1, k, n) + hi(i, n_cell, k, n)));
+        });
+      }
+
+      // Stand-in for the rest of the time step
+      t0 = ParallelDescriptor::second();
+      while (ParallelDescriptor::second() - t0 < work_time) {
+      }
+      t_work += ParallelDescriptor::second() - t0;
+    }
+
+    Print() << " " << nsteps << " steps, " << t_work << " s of solver work\n";
+    Print() << "   inflow read when needed: " << t_sync << " s\n";
+    Print() << "   inflow read ahead:       " << t_prefetch << " s\n";
+    Print() << "   max difference:          " << maxdiff << "\n";
+    turb.print_io_stats();
+    // Both faces read the same planes, whether they are read ahead or not
+    if (maxdiff > 0.0) {
+      Abort("Inflow read ahead differs from inflow read when needed");
+    }
+  }
+  Finalize();
+
+  return 0;
+}